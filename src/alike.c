@@ -19,6 +19,17 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 #include "settings.h"
 #include "alike.h"
 
+// Lists with at least this many elements get the pre-pass in
+// `ALIKEC_vec_same`
+
+#define ALIKEC_PREPASS_MIN 8
+
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 5, 0)
+#define ALIKEC_ALTREP(x) ALTREP(x)
+#else
+#define ALIKEC_ALTREP(x) 0
+#endif
+
 /*-----------------------------------------------------------------------------\
 \-----------------------------------------------------------------------------*/
 /*
@@ -35,28 +46,45 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
  *
  * This can then be assembled into "should be integer (is character)" or
  * potentially collapsed with other messages with `ALIKE_merge_msg`.
+ *
+ * This does not allocate or copy the strings; see the `ALIKEC_res_msg` docs.
  */
-SEXP ALIKEC_res_msg_def(
+struct ALIKEC_res_msg ALIKEC_res_msg_def(
   const char * tar_pre, const char * target,
   const char * act_pre, const char * actual
 ) {
-  SEXP res = PROTECT(allocVector(VECSXP, 2));
-  SEXP res_msg = PROTECT(allocVector(STRSXP, 4));
-
-  SET_STRING_ELT(res_msg, 0, mkChar(tar_pre));
-  SET_STRING_ELT(res_msg, 1, mkChar(target));
-  SET_STRING_ELT(res_msg, 2, mkChar(act_pre));
-  SET_STRING_ELT(res_msg, 3, mkChar(actual));
-
-  SET_VECTOR_ELT(res, 0, res_msg);                // message
-  SET_VECTOR_ELT(res, 1, allocVector(VECSXP, 2)); // wrap
+  return (struct ALIKEC_res_msg) {
+    .strings={
+      .tar_pre=tar_pre, .target=target, .act_pre=act_pre, .actual=actual
+    },
+    .wrap=R_NilValue
+  };
+}
+struct ALIKEC_res_msg ALIKEC_res_msg_none() {
+  return (struct ALIKEC_res_msg) {
+    .strings={.tar_pre=NULL, .target=NULL, .act_pre=NULL, .actual=NULL},
+    .wrap=R_NilValue
+  };
+}
+/*
+ * Convert a message into the SEXP form used by the external interfaces, a list
+ * with the four strings as a character vector in the "message" element and the
+ * wrap list in the "wrap" element, or NULL if the message is unset.
+ */
+SEXP ALIKEC_res_msg_as_sxp(struct ALIKEC_res_msg msg) {
+  if(!msg.strings.target) return R_NilValue;
 
+  SEXP res = PROTECT(allocVector(VECSXP, 2));
+  SET_VECTOR_ELT(res, 0, ALIKEC_res_strings_to_SEXP(msg.strings));  // message
+  SET_VECTOR_ELT(                                                  // wrap
+    res, 1, msg.wrap != R_NilValue ? msg.wrap : allocVector(VECSXP, 2)
+  );
   SEXP res_names = PROTECT(allocVector(STRSXP, 2));
   SET_STRING_ELT(res_names, 0, mkChar("message"));
   SET_STRING_ELT(res_names, 1, mkChar("wrap"));
 
   setAttrib(res, R_NamesSymbol, res_names);
-  UNPROTECT(3);
+  UNPROTECT(2);
 
   return res;
 }
@@ -78,14 +106,14 @@ Other struct initialization functions
 struct ALIKEC_res_sub ALIKEC_res_sub_def() {
   return (struct ALIKEC_res_sub) {
     .success=1,
-    .message=R_NilValue,
+    .message=ALIKEC_res_msg_none(),
     .df=0
   };
 }
 struct ALIKEC_res ALIKEC_res_def() {
   return (struct ALIKEC_res) {
     .success=1,
-    .message=R_NilValue, // so we don't need to protect yet
+    .message=ALIKEC_res_msg_none(), // so we don't need to protect yet
     .df=0,
     .rec=ALIKEC_rec_def()
   };
@@ -129,7 +157,7 @@ struct ALIKEC_res ALIKEC_alike_obj(
       const char * msg_tmp = CSR_smprintf4(
         set.nchar_max, "%sbe", (s4_tar ? "" : "not "), "", "", ""
       );
-      res.message = PROTECT(ALIKEC_res_msg_def(msg_tmp, "S4", "", ""));
+      res.message = ALIKEC_res_msg_def(msg_tmp, "S4", "", "");
     } else {
       SEXP klass, klass_attrib;
       SEXP s, t;
@@ -172,12 +200,10 @@ struct ALIKEC_res ALIKEC_alike_obj(
           set.nchar_max, "S4 class \"%s\" (package: %s)",
           CHAR(asChar(klass)), CHAR(asChar(klass_attrib)), "", ""
         );
-        res.message = PROTECT(
-          ALIKEC_res_msg_def("inherit from", msg_tmp, "", "")
-        );
-      } else PROTECT(R_NilValue);
+        res.message = ALIKEC_res_msg_def("inherit from", msg_tmp, "", "");
+      }
     }
-    PROTECT(R_NilValue); // stack balance with next `else if`
+    PROTECT(PROTECT(PROTECT(R_NilValue))); // stack balance with next `else if`
   } else if(target != R_NilValue) {  // Nil objects match anything when nested
     // - Attributes ------------------------------------------------------------
     /*
@@ -189,7 +215,7 @@ struct ALIKEC_res ALIKEC_alike_obj(
     struct ALIKEC_res_sub res_attr = ALIKEC_compare_attributes_internal(
       target, current, set
     );
-    PROTECT(res_attr.message);
+    PROTECT(res_attr.message.wrap);
 
     is_df = res_attr.df;
     err_lvl = res_attr.lvl;
@@ -221,7 +247,7 @@ struct ALIKEC_res ALIKEC_alike_obj(
       struct ALIKEC_res_sub res_lang = ALIKEC_lang_alike_internal(
         target, current, set
       );
-      PROTECT(res_lang.message);
+      PROTECT(res_lang.message.wrap);
       if(!res_lang.success) {
         err = 1;
         res.message = res_lang.message;
@@ -271,27 +297,31 @@ struct ALIKEC_res ALIKEC_alike_obj(
         err_tmp_1 && err_tmp_2 && tar_len != (cur_len = xlength(current))
       ) {
         err = 1;
-        err_tok1 = CSR_len_as_chr(tar_len);
-        err_tok2 = CSR_len_as_chr(cur_len);
-        if(is_df) {
-          msg_tar_pre = "have";
-          msg_target = CSR_smprintf4(
-            set.nchar_max, "%s column%s",
-            err_tok1, tar_len == (R_xlen_t) 1 ? "" : "s", "",  ""
-          );
-          msg_act_pre = "has";
-          msg_actual = CSR_smprintf4(
-            set.nchar_max, "%s", err_tok2,  "", "", ""
-          );
+        if(set.no_msg) {
+          msg_target = "length";
         } else {
-          msg_tar_pre = "be";
-          msg_target = CSR_smprintf4(
-            set.nchar_max, "length %s", err_tok1,  "",  "", ""
-          );
-          msg_act_pre = "is";
-          msg_actual = CSR_smprintf4(
-            set.nchar_max, "%s", err_tok2,  "", "", ""
-          );
+          err_tok1 = CSR_len_as_chr(tar_len);
+          err_tok2 = CSR_len_as_chr(cur_len);
+          if(is_df) {
+            msg_tar_pre = "have";
+            msg_target = CSR_smprintf4(
+              set.nchar_max, "%s column%s",
+              err_tok1, tar_len == (R_xlen_t) 1 ? "" : "s", "",  ""
+            );
+            msg_act_pre = "has";
+            msg_actual = CSR_smprintf4(
+              set.nchar_max, "%s", err_tok2,  "", "", ""
+            );
+          } else {
+            msg_tar_pre = "be";
+            msg_target = CSR_smprintf4(
+              set.nchar_max, "length %s", err_tok1,  "",  "", ""
+            );
+            msg_act_pre = "is";
+            msg_actual = CSR_smprintf4(
+              set.nchar_max, "%s", err_tok2,  "", "", ""
+            );
+          }
         }
       } else if (
         is_df && err_lvl > 0 && tar_type == VECSXP && XLENGTH(target) &&
@@ -305,29 +335,32 @@ struct ALIKEC_res ALIKEC_alike_obj(
         // check the first column only
 
         err = 1;
-        msg_tar_pre = "have";
-        msg_target = CSR_smprintf4(
-          set.nchar_max, "%s row%s",
-          CSR_len_as_chr(tar_first_el_len),
-          tar_first_el_len == (R_xlen_t) 1 ? "" : "s", "", ""
-        );
-        msg_act_pre = "has";
-        msg_actual = CSR_smprintf4(
-          set.nchar_max, "%s",
-          CSR_len_as_chr(cur_first_el_len), "", "", ""
-        );
-    } }
+        if(set.no_msg) {
+          msg_target = "rows";
+        } else {
+          msg_tar_pre = "have";
+          msg_target = CSR_smprintf4(
+            set.nchar_max, "%s row%s",
+            CSR_len_as_chr(tar_first_el_len),
+            tar_first_el_len == (R_xlen_t) 1 ? "" : "s", "", ""
+          );
+          msg_act_pre = "has";
+          msg_actual = CSR_smprintf4(
+            set.nchar_max, "%s",
+            CSR_len_as_chr(cur_first_el_len), "", "", ""
+          );
+        }
+      }
+    }
     // If no normal, errors, use the attribute error
 
     if(!err && err_attr) {
-      res.message = PROTECT(res_attr.message);
-    } else if(err && msg_target[0]) {
-      res.message = PROTECT(
-        ALIKEC_res_msg_def(msg_tar_pre, msg_target, msg_act_pre, msg_actual)
-      );
-    } else {
-      PROTECT(R_NilValue);
+      res.message = res_attr.message;
+    } else if(err && msg_target[0] && !set.no_msg) {
+      res.message =
+        ALIKEC_res_msg_def(msg_tar_pre, msg_target, msg_act_pre, msg_actual);
     }
+    PROTECT(R_NilValue);
   } else {
     PROTECT(PROTECT(PROTECT(R_NilValue)));
   }
@@ -372,6 +405,70 @@ struct ALIKEC_res ALIKEC_alike_obj(
   return res;
 }
 /*
+Whether two attribute pairlists are the same, either because the values are
+the same objects or because they are plain character vectors with the same
+CHARSXPs (e.g. class attributes).  Does not allocate.
+*/
+static int ALIKEC_attr_same(SEXP tar, SEXP cur) {
+  for(; tar != cur; tar = CDR(tar), cur = CDR(cur)) {
+    if(tar == R_NilValue || cur == R_NilValue || TAG(tar) != TAG(cur))
+      return 0;
+    SEXP tar_val = CAR(tar), cur_val = CAR(cur);
+    if(tar_val == cur_val) continue;
+    if(
+      TYPEOF(tar_val) != STRSXP || TYPEOF(cur_val) != STRSXP ||
+      ALIKEC_ALTREP(tar_val) || ALIKEC_ALTREP(cur_val) ||
+      ATTRIB(tar_val) != R_NilValue || ATTRIB(cur_val) != R_NilValue
+    )
+      return 0;
+    R_xlen_t len = XLENGTH(tar_val);
+    if(len != XLENGTH(cur_val)) return 0;
+    for(R_xlen_t i = 0; i < len; ++i)
+      if(STRING_ELT(tar_val, i) != STRING_ELT(cur_val, i)) return 0;
+  }
+  return 1;
+}
+/*
+Whether `ALIKEC_alike_rec` is certain to succeed on a list element: atomic
+vectors of the same type, with compatible lengths, and the same attributes.
+Anything else, including ALTREP (their length could require a method
+dispatch) and S4 objects, must go through the normal path.
+*/
+static int ALIKEC_el_same(SEXP tar, SEXP cur) {
+  switch(TYPEOF(tar)) {
+    case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP: case STRSXP:
+    case RAWSXP:
+      break;
+    default:
+      return 0;
+  }
+  if(
+    TYPEOF(cur) != TYPEOF(tar) || ALIKEC_ALTREP(tar) || ALIKEC_ALTREP(cur) ||
+    IS_S4_OBJECT(tar) || IS_S4_OBJECT(cur)
+  )
+    return 0;
+  R_xlen_t tar_len = XLENGTH(tar);
+  if(tar_len && tar_len != XLENGTH(cur)) return 0;
+  return ALIKEC_attr_same(ATTRIB(tar), ATTRIB(cur));
+}
+/*
+Structural pre-pass over the elements of lists that have already been checked
+for type and length.  Wide data frames matched against zero row templates
+spend most of their time running the full `ALIKEC_alike_obj` machinery on
+columns that trivially match; here we find those columns with plain C reads
+so the caller only has to recurse into the others.  Lists shorter than
+`ALIKEC_PREPASS_MIN` always take the normal path.
+
+@return non-zero if element `i` is known to match
+*/
+static int ALIKEC_vec_same(SEXP target, SEXP current, R_xlen_t i) {
+  R_xlen_t len = XLENGTH(target);
+  return
+    len >= ALIKEC_PREPASS_MIN && TYPEOF(current) == TYPEOF(target) &&
+    XLENGTH(current) == len &&
+    ALIKEC_el_same(VECTOR_ELT(target, i), VECTOR_ELT(current, i));
+}
+/*
 Utility functions for updating index lest for error reporting.  General logic
 is to track depth of recursion, and when an error occurs, allocate enough
 space for as many ALIKEC_index structs as there is recursion depth.
@@ -408,7 +505,7 @@ struct ALIKEC_res ALIKEC_alike_rec(
 
   struct ALIKEC_res res = ALIKEC_alike_obj(target, current, set);
 
-  PROTECT(res.message);
+  PROTECT(res.message.wrap);
   res.rec = rec;
 
   if(!res.success) {
@@ -421,13 +518,18 @@ struct ALIKEC_res ALIKEC_alike_rec(
 
     if(tar_type == VECSXP || tar_type == EXPRSXP) {
       R_xlen_t i;
-
       for(i = 0; i < tar_len; i++) {
+        // a successful recursion leaves everything but `df` unchanged
+
+        if(ALIKEC_vec_same(target, current, i)) {
+          res.df = 0;
+          continue;
+        }
         res = ALIKEC_alike_rec(
           VECTOR_ELT(target, i), VECTOR_ELT(current, i), res.rec, set
         );
         UNPROTECT(1);
-        PROTECT(res.message);
+        PROTECT(res.message.wrap);
 
         if(!res.success) {
           SEXP vec_names = getAttrib(target, R_NamesSymbol);
@@ -469,9 +571,8 @@ struct ALIKEC_res ALIKEC_alike_rec(
       } else {
         if(target == R_GlobalEnv && current != R_GlobalEnv) {
           res.success = 0;
-          UNPROTECT(1);
           res.message =
-            PROTECT(ALIKEC_res_msg_def("be", "the global environment", "", ""));
+            ALIKEC_res_msg_def("be", "the global environment", "", "");
         } else {
           SEXP tar_names = PROTECT(R_lsInternal(target, TRUE));
           R_xlen_t tar_name_len = XLENGTH(tar_names), i;
@@ -489,16 +590,13 @@ struct ALIKEC_res ALIKEC_alike_rec(
             SEXP var_cur_val = findVarInFrame(current, var_name);
             if(var_cur_val == R_UnboundValue) {
               res.success = 0;
-              UNPROTECT(1);
-              res.message=PROTECT(
-                ALIKEC_res_msg_def(
-                  "contain",
-                  CSR_smprintf4(
-                    set.nchar_max, "variable `%s`",
-                    CHAR(asChar(STRING_ELT(tar_names, i))), "", "", ""
-                  ),
-                  "", ""
-                )
+              res.message = ALIKEC_res_msg_def(
+                "contain",
+                CSR_smprintf4(
+                  set.nchar_max, "variable `%s`",
+                  CHAR(asChar(STRING_ELT(tar_names, i))), "", "", ""
+                ),
+                "", ""
               );
               UNPROTECT(1); // unprotect var_name
               break;
@@ -507,7 +605,7 @@ struct ALIKEC_res ALIKEC_alike_rec(
                 findVarInFrame(target, var_name), var_cur_val, res.rec, set
               );
               UNPROTECT(1);
-              PROTECT(res.message);
+              PROTECT(res.message.wrap);
 
               UNPROTECT(1); // unprotect var_name
               if(!res.success) {
@@ -529,23 +627,20 @@ struct ALIKEC_res ALIKEC_alike_rec(
         SEXP tar_tag = TAG(tar_sub);
         SEXP tar_tag_chr = PRINTNAME(tar_tag);
         if(tar_tag != R_NilValue && tar_tag != TAG(cur_sub)) {
-          UNPROTECT(1);
-          res.message= PROTECT(
-            ALIKEC_res_msg_def(
-              "have",
-              CSR_smprintf4(
-                set.nchar_max, "name \"%s\" at pairlist index [[%s]]",
-                CHAR(asChar(tar_tag_chr)), CSR_len_as_chr(i + 1), "", ""
-              ),
-              "", ""
-            )
+          res.message = ALIKEC_res_msg_def(
+            "have",
+            CSR_smprintf4(
+              set.nchar_max, "name \"%s\" at pairlist index [[%s]]",
+              CHAR(asChar(tar_tag_chr)), CSR_len_as_chr(i + 1), "", ""
+            ),
+            "", ""
           );
           res.success = 0;
           break;
         } else {
           res = ALIKEC_alike_rec(CAR(tar_sub), CAR(cur_sub), res.rec, set);
           UNPROTECT(1);
-          PROTECT(res.message);
+          PROTECT(res.message.wrap);
           if(!res.success) {
             if(tar_tag != R_NilValue)
               res.rec =
@@ -578,7 +673,13 @@ struct ALIKEC_res ALIKEC_alike_internal(
 
   struct ALIKEC_res res = ALIKEC_res_def();
 
-  // Note, no PROTECTion since we exit immediately (res.message is SEXP)
+  // Schemas can only confirm success, anything else gets the full check
+
+  if(ALIKEC_is_schema(target)) {
+    if(ALIKEC_schema_alike(target, current, set)) return res;
+    target = ALIKEC_schema_template(target);
+  }
+  // Note, no PROTECTion since we exit immediately
 
   if(TYPEOF(target) == NILSXP && TYPEOF(current) != NILSXP) {
     // Handle NULL special case at top level
@@ -615,10 +716,17 @@ struct ALIKEC_res_fin ALIKEC_alike_wrap(
     error("Internal Error; `curr_sub` must be language."); // nocov
 
   struct ALIKEC_res res = ALIKEC_alike_internal(target, current, set);
-  PROTECT(res.message);
+  PROTECT(res.message.wrap);
   struct ALIKEC_res_fin res_out = {
     .tar_pre = "", .target="", .act_pre="", .actual="", .call = ""
   };
+  // Without messages we can only report the failure
+
+  if(!res.success && set.no_msg) {
+    res_out.target = "alike";
+    UNPROTECT(1);
+    return res_out;
+  }
   // Have an error, need to populate the object by deparsing the relevant
   // expression.  One issue here is we want different treatment depending on
   // how wide the error is; if the error is short enough we can include it
@@ -628,14 +736,15 @@ struct ALIKEC_res_fin ALIKEC_alike_wrap(
     // Get indices, and sub in the current substituted expression if they
     // exist
 
-    res_out.tar_pre= CHAR(STRING_ELT(VECTOR_ELT(res.message, 0), 0));
-    res_out.target = CHAR(STRING_ELT(VECTOR_ELT(res.message, 0), 1));
+    res_out.tar_pre = res.message.strings.tar_pre;
+    res_out.target = res.message.strings.target;
 
-    res_out.act_pre = CHAR(STRING_ELT(VECTOR_ELT(res.message, 0), 2));
-    res_out.actual = CHAR(STRING_ELT(VECTOR_ELT(res.message, 0), 3));
+    res_out.act_pre = res.message.strings.act_pre;
+    res_out.actual = res.message.strings.actual;
 
     SEXP rec_ind = PROTECT(ALIKEC_rec_ind_as_lang(res.rec));
-    SEXP wrap = VECTOR_ELT(res.message, 1);
+    SEXP wrap = res.message.wrap;
+    SEXP wrap_call = wrap != R_NilValue ? VECTOR_ELT(wrap, 0) : R_NilValue;
 
     // Need to check if our call could become ambigous with the indexing
     // element (e.g. `1 + x[[1]][[2]]` should be `(1 + x)[[1]][[2]]`
@@ -647,7 +756,7 @@ struct ALIKEC_res_fin ALIKEC_alike_wrap(
       ALIKEC_is_an_op(curr_sub) &&
       (
         ALIKEC_is_an_op(VECTOR_ELT(rec_ind, 0)) ||
-        ALIKEC_is_an_op_inner(VECTOR_ELT(wrap, 0))
+        ALIKEC_is_an_op_inner(wrap_call)
       )
     ) {
       curr_sub = PROTECT(lang2(ALIKEC_SYM_paren_open, curr_sub));
@@ -663,9 +772,9 @@ struct ALIKEC_res_fin ALIKEC_alike_wrap(
     // Merge the wrap call with the original call so we can get stuff like
     // `names(curr_sub)`
 
-    if(VECTOR_ELT(wrap, 0) != R_NilValue) {
+    if(wrap_call != R_NilValue) {
       SETCAR(VECTOR_ELT(wrap, 1), curr_sub);
-      curr_sub = VECTOR_ELT(wrap, 0);
+      curr_sub = wrap_call;
     }
     // Deparse and format the call
 
@@ -700,6 +809,16 @@ SEXP ALIKEC_alike_ext(
     ALIKEC_alike_wrap(target, current, curr_sub, set), set
   );
 }
+/*
+ * Logical only interface, never constructs error messages
+ */
+SEXP ALIKEC_alike_lgl_ext(
+  SEXP target, SEXP current, SEXP env, SEXP settings
+) {
+  struct VALC_settings set = VALC_settings_vet(settings, env);
+  set.no_msg = 1;
+  return ScalarLogical(ALIKEC_alike_internal(target, current, set).success);
+}
 /*
  * Another secondary, but takes the set struct instead of SEXP list, and returns
  * length 5 character vectors for the errors instead of length 1 so that the
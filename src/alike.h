@@ -19,6 +19,7 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 #include "cstringr.h"
 #include "pfhash.h"
 #include "settings.h"
+#include "scan.h"
 #include <wchar.h>
 
 #ifndef _ALIKEC_H
@@ -76,23 +77,29 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
     const char * act_pre;
     const char * actual;
   };
-  // We used a SEXP because it contains the error message, as well as the wrap
-  // component that we can use around the call (e.g "names(%s)[[1]]"), and the
-  // latter contains symbols
+  // Failure descriptions are carried through the engine as plain C structs
+  // and only converted to SEXPs with `ALIKEC_res_msg_as_sxp` at the `.Call`
+  // boundary, so a failing comparison that is discarded (e.g. a failed `||`
+  // branch) does not allocate a message list.
   //
-  // The SEXP is of type VECSXP (i.e. list), and contains two elements.
+  // The strings must outlive the comparison, so they are either literals,
+  // strings allocated by the CSR functions, or CHARs of protected objects.
+  // They are NULL if the message is unset.
   //
-  // The first element is the message, which itself contains the "target"
-  // string, i.e. what the object should be, and the "actual", what it is.,
-  //
-  // The second is the wrap which is a two element list where the first element
-  // is the wrapping call, and the second (I think) is a pointer to the inside
-  // of the call which is where we will ultimately substitute the original call
-  // (not 100% certain of this; I'm writing these docs way after the fact...)
+  // `wrap` is the call that we can use around the original call (e.g
+  // "names(%s)[[1]]").  It is R_NilValue if there is none, or a two element
+  // list where the first element is the wrapping call, and the second is a
+  // pointer to the inside of the call which is where we will ultimately
+  // substitute the original call.  `wrap` is the only part of the message
+  // that needs PROTECTing.
 
+  struct ALIKEC_res_msg {
+    struct ALIKEC_res_strings strings;
+    SEXP wrap;
+  };
   struct ALIKEC_res {
     int success;
-    SEXP message;
+    struct ALIKEC_res_msg message;
     int df;
     struct ALIKEC_rec_track rec;
   };
@@ -110,37 +117,58 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 
   struct ALIKEC_res_sub {
     int success;
-    SEXP message;
+    struct ALIKEC_res_msg message;
     int df;      // whether df or not, not use by all functions
     int lvl;     // Type of error used for prioritizing
   };
 
+  // R options used to render messages, see `ALIKEC_opts_get`
+
+  struct ALIKEC_opts {
+    int width;
+    const char * prompt;
+    const char * cont;
+  };
+
   // - Main Funs --------------------------------------------------------------
 
   SEXP ALIKEC_alike_ext(
     SEXP target, SEXP current, SEXP cur_sub, SEXP env, SEXP settings
   );
+  SEXP ALIKEC_alike_lgl_ext(
+    SEXP target, SEXP current, SEXP env, SEXP settings
+  );
   SEXP ALIKEC_alike_int2(
     SEXP target, SEXP current, SEXP curr_sub, struct VALC_settings set
   );
   struct ALIKEC_res ALIKEC_alike_internal(
     SEXP target, SEXP current, struct VALC_settings set
   );
+  SEXP ALIKEC_schema_ext(SEXP template);
   SEXP ALIKEC_typeof(SEXP object);
   SEXP ALIKEC_type_alike(SEXP target, SEXP current, SEXP call, SEXP mode);
 
   // - Internal Funs ----------------------------------------------------------
 
-  SEXPTYPE ALIKEC_typeof_internal(SEXP object);
+  SEXPTYPE ALIKEC_typeof_internal(SEXP object, int par_min_len);
+  struct ALIKEC_res ALIKEC_alike_rec(
+    SEXP target, SEXP current, struct ALIKEC_rec_track rec,
+    struct VALC_settings set
+  );
+  int ALIKEC_is_schema(SEXP x);
+  SEXP ALIKEC_schema_template(SEXP schema);
+  int ALIKEC_schema_alike(SEXP schema, SEXP current, struct VALC_settings set);
   struct ALIKEC_res_fin ALIKEC_type_alike_internal(
     SEXP target, SEXP current, SEXP call, struct VALC_settings set
   );
   SEXP ALIKEC_compare_attributes(SEXP target, SEXP current, SEXP attr_mode);
   SEXP ALIKEC_compare_special_char_attrs(SEXP target, SEXP current);
-  SEXP ALIKEC_res_msg_def(
+  struct ALIKEC_res_msg ALIKEC_res_msg_def(
     const char * tar_pre, const char * target,
     const char * act_pre, const char * actual
   );
+  struct ALIKEC_res_msg ALIKEC_res_msg_none();
+  SEXP ALIKEC_res_msg_as_sxp(struct ALIKEC_res_msg msg);
   struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
     SEXP target, SEXP current, struct VALC_settings set
   );
@@ -183,7 +211,8 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
   SEXP ALIKEC_test2(
     SEXP target, SEXP current
   );
-  SEXP ALIKEC_getopt(const char * opt);
+  SEXP ALIKEC_getopt(SEXP opt);
+  struct ALIKEC_opts ALIKEC_opts_get();
   SEXP ALIKEC_deparse_ext(SEXP obj, SEXP width_cutoff);
   SEXP ALIKEC_deparse_oneline_ext(
     SEXP obj, SEXP max_chars, SEXP keep_at_end
@@ -213,6 +242,7 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
   SEXP ALIKEC_abstract_ts(SEXP x, SEXP what);
   int ALIKEC_env_track(SEXP env, struct ALIKEC_env_track * envs, int env_limit);
   SEXP ALIKEC_env_track_test(SEXP env, SEXP stack_size_init, SEXP env_limit);
+  SEXP ALIKEC_alloc_test(SEXP target, SEXP current, SEXP reps);
   struct ALIKEC_env_track * ALIKEC_env_set_create(
     int stack_size_init, int env_limit
   );
@@ -223,12 +253,14 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
   struct ALIKEC_rec_track ALIKEC_rec_inc(struct ALIKEC_rec_track);
   struct ALIKEC_rec_track ALIKEC_rec_dec(struct ALIKEC_rec_track);
   SEXP ALIKEC_syntactic_names_exp(SEXP lang);
-  SEXP ALIKEC_sort_msg(SEXP msgs, struct VALC_settings set);
+  SEXP ALIKEC_sort_msg(SEXP msgs);
   SEXP ALIKEC_sort_msg_ext(SEXP msgs);
   SEXP ALIKEC_merge_msg(SEXP msgs, struct VALC_settings set);
   SEXP ALIKEC_merge_msg_ext(SEXP msgs);
   SEXP ALIKEC_merge_msg_2(SEXP msgs, struct VALC_settings set);
   SEXP ALIKEC_merge_msg_2_ext(SEXP msgs);
+  SEXP ALIKEC_dedupe_msg(SEXP msgs);
+  SEXP ALIKEC_dedupe_msg_ext(SEXP msgs);
 
   // - Init and pre-install Symbols -------------------------------------------
 
@@ -239,7 +271,9 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
   SEXP ALIKEC_SYM_args;
   SEXP ALIKEC_SYM_deparse;
   SEXP ALIKEC_SYM_nlines;
-  SEXP ALIKEC_SYM_getOption;
+  SEXP ALIKEC_SYM_width;
+  SEXP ALIKEC_SYM_prompt;
+  SEXP ALIKEC_SYM_continue;
   SEXP ALIKEC_SYM_matchcall;
   SEXP ALIKEC_SYM_widthcutoff;
   SEXP ALIKEC_CALL_matchcall;
@@ -250,4 +284,5 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
   SEXP ALIKEC_SYM_colnames;
   SEXP ALIKEC_SYM_length;
   SEXP ALIKEC_SYM_syntacticnames;
+  SEXP ALIKEC_SYM_schema;
 #endif
@@ -18,8 +18,13 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 
 #include "alike.h"
 
+// Number of attributes at which we switch from the nested pairlist scan to a
+// pointer hash in `ALIKEC_compare_attributes_internal`; see DEVNOTES.md
+
+#define ALIKEC_ATTR_HASH_MIN 24
+
 SEXP ALIKEC_res_sub_as_sxp(struct ALIKEC_res_sub sub) {
-  PROTECT(sub.message);
+  PROTECT(sub.message.wrap);
   SEXP out = PROTECT(allocVector(VECSXP, 4));
   SEXP out_names = PROTECT(allocVector(STRSXP, 4));
   const char * names[4] = {"success", "message", "df", "lvl"};
@@ -28,7 +33,7 @@ SEXP ALIKEC_res_sub_as_sxp(struct ALIKEC_res_sub sub) {
   for(i = 0; i < 4; i++) SET_STRING_ELT(out_names, i, mkChar(names[i]));
 
   SET_VECTOR_ELT(out, 0, ScalarInteger(sub.success));
-  SET_VECTOR_ELT(out, 1, sub.message);
+  SET_VECTOR_ELT(out, 1, ALIKEC_res_msg_as_sxp(sub.message));
   SET_VECTOR_ELT(out, 2, ScalarInteger(sub.df));
   SET_VECTOR_ELT(out, 3, ScalarInteger(sub.lvl));
   setAttrib(out, R_NamesSymbol, out_names);
@@ -63,14 +68,20 @@ SEXP ALIKEC_attr_wrap(SEXP tag, SEXP call) {
   return wrap;
 }
 /*
-Take an existing wrap and insert another wrapping call inside the wrap
-
-Note this always assumes that the ultimate target of the wrapping is the CDR of
-`call`
+Take an existing wrap and insert another wrapping call inside the wrap, with
+`hole` the pairlist cell in `call` where the inside of the wrap goes.
 
-This function modifies `wrap` and does not return
+This function modifies `wrap`, or if it is R_NilValue creates a new one, and
+returns it.  `call` must be PROTECTed, and the return value is not.
 */
-void ALIKEC_wrap_around(SEXP wrap, SEXP call) {
+SEXP ALIKEC_wrap_around_at(SEXP wrap, SEXP call, SEXP hole) {
+  if(wrap == R_NilValue) {
+    wrap = PROTECT(allocVector(VECSXP, 2));
+    SET_VECTOR_ELT(wrap, 0, call);
+    SET_VECTOR_ELT(wrap, 1, hole);
+    UNPROTECT(1);
+    return wrap;
+  }
   if(TYPEOF(wrap) != VECSXP && xlength(wrap) != 2)
     error("Internal Error: Unexpected format for wrap object");  // nocov
   SEXP w1 = VECTOR_ELT(wrap, 0);
@@ -90,7 +101,15 @@ void ALIKEC_wrap_around(SEXP wrap, SEXP call) {
   } else {
     SETCAR(w2, call);
   }
-  SET_VECTOR_ELT(wrap, 1, CDR(call));
+  SET_VECTOR_ELT(wrap, 1, hole);
+  return wrap;
+}
+/*
+As `ALIKEC_wrap_around_at` for the common case where the inside of the wrap
+goes in the first argument of `call`
+*/
+SEXP ALIKEC_wrap_around(SEXP wrap, SEXP call) {
+  return ALIKEC_wrap_around_at(wrap, call, CDR(call));
 }
 /*
 Runs alike on an attribute, really just like running alike, but since it is on
@@ -120,18 +139,37 @@ struct ALIKEC_res_sub ALIKEC_alike_attr(
 
   if(!res.success) {
     res_sub.success = 0;
-    res_sub.message = PROTECT(
-      ALIKEC_res_msg_def(
-        "be", "`alike` the corresponding element in target", "", ""
-      )
+    res_sub.message = ALIKEC_res_msg_def(
+      "be", "`alike` the corresponding element in target", "", ""
     );
-    SEXP wrap = PROTECT(ALIKEC_attr_wrap(attr_symb, R_NilValue));
-    SET_VECTOR_ELT(res_sub.message, 1, wrap);
-    UNPROTECT(2);
+    res_sub.message.wrap = ALIKEC_attr_wrap(attr_symb, R_NilValue);
   }
   return res_sub;
 }
 
+/*-----------------------------------------------------------------------------\
+\-----------------------------------------------------------------------------*/
+/*
+CHARSXP comparisons.  R caches CHARSXPs so equal strings in the same encoding
+are the same object and we only need to look at the strings when the pointers
+differ.
+
+`ALIKEC_chr_eq` also treats the same string in different encodings as equal,
+as `identical` does.
+*/
+static int ALIKEC_chr_eq(SEXP a, SEXP b) {
+  if(a == b) return 1;
+  if(getCharCE(a) == getCharCE(b)) return !strcmp(CHAR(a), CHAR(b));
+  return !strcmp(translateCharUTF8(a), translateCharUTF8(b));
+}
+static int ALIKEC_chr_is_df(SEXP x) {
+  static SEXP df_chr;
+  if(!df_chr) {
+    df_chr = mkChar("data.frame");
+    R_PreserveObject(df_chr);
+  }
+  return ALIKEC_chr_eq(x, df_chr);
+}
 /*-----------------------------------------------------------------------------\
 \-----------------------------------------------------------------------------*/
 /*
@@ -152,8 +190,8 @@ struct ALIKEC_res_sub ALIKEC_compare_class(
       is_df = 0;
   const char * cur_class;
   const char * tar_class;
+  SEXP cur_class_chr, tar_class_chr;
   struct ALIKEC_res_sub res = ALIKEC_res_sub_def();
-  res.message = PROTECT(ALIKEC_res_msg_def("", "", "", ""));
 
   tar_class_len = XLENGTH(target);
   cur_class_len = XLENGTH(current);
@@ -167,16 +205,23 @@ struct ALIKEC_res_sub ALIKEC_compare_class(
     cur_class_i < cur_class_len;
     cur_class_i++, tar_class_i++
   ) {
-    cur_class = CHAR(STRING_ELT(current, cur_class_i));
-    tar_class = CHAR(STRING_ELT(target, tar_class_i));
-    if(!is_df && !strcmp(tar_class, "data.frame")) is_df = 1;
+    cur_class_chr = STRING_ELT(current, cur_class_i);
+    tar_class_chr = STRING_ELT(target, tar_class_i);
+    if(!is_df && ALIKEC_chr_is_df(tar_class_chr)) is_df = 1;
+    if(!res.success || cur_class_chr == tar_class_chr) continue;
 
-    if(res.success && strcmp(cur_class, tar_class)) { // class mismatch
+    if(!ALIKEC_chr_eq(cur_class_chr, tar_class_chr)) { // class mismatch
       res.success = 0;
-
-      SEXP msg_strings = VECTOR_ELT(res.message, 0);
+      cur_class = CHAR(cur_class_chr);
+      tar_class = CHAR(tar_class_chr);
 
       if(cur_class_len > 1) {
+        res.message = ALIKEC_res_msg_def(
+          "be",
+          CSR_smprintf4(set.nchar_max, "\"%s\"", tar_class, "", "", ""),
+          "is",
+          CSR_smprintf4(set.nchar_max, "\"%s\"", cur_class, "", "", "")
+        );
         SEXP wrap_call = PROTECT(
           lang3(
             R_BracketSymbol, lang2(R_ClassSymbol, R_NilValue),
@@ -186,58 +231,38 @@ struct ALIKEC_res_sub ALIKEC_compare_class(
 
         SET_VECTOR_ELT(wrap, 0, wrap_call);
         SET_VECTOR_ELT(wrap, 1, CDR(CADR(wrap_call)));
-        SET_VECTOR_ELT(res.message, 1, wrap);
+        res.message.wrap = wrap;
         UNPROTECT(2);
-
-        SET_STRING_ELT(msg_strings, 0, mkChar("be"));
-        SET_STRING_ELT(
-          msg_strings, 1, mkChar(
-            CSR_smprintf4(set.nchar_max, "\"%s\"", tar_class, "", "", "")
-        ) );
-        SET_STRING_ELT(msg_strings, 2, mkChar("is"));
-        SET_STRING_ELT(
-          msg_strings, 3,
-          mkChar(
-            CSR_smprintf4(set.nchar_max, "\"%s\"", cur_class, "", "", "")
-        ) );
       } else {
-        SET_STRING_ELT(msg_strings, 0, mkChar("be"));
-        SET_STRING_ELT(
-            msg_strings, 1,
-            mkChar(
-              CSR_smprintf4(
-                set.nchar_max,  "class \"%s\"", tar_class, "", "", ""
-        ) ) );
-        SET_STRING_ELT(msg_strings, 2, mkChar("is"));
-        SET_STRING_ELT(
-          msg_strings, 3,
-            mkChar(
-              CSR_smprintf4(
-                set.nchar_max,  "\"%s\"", cur_class, "", "", ""
-        ) ) );
+        res.message = ALIKEC_res_msg_def(
+          "be",
+          CSR_smprintf4(
+            set.nchar_max,  "class \"%s\"", tar_class, "", "", ""
+          ),
+          "is",
+          CSR_smprintf4(set.nchar_max,  "\"%s\"", cur_class, "", "", "")
+        );
   } } }
   // Check to make sure have enough classes
 
   if(res.success) {
     if(tar_class_len > cur_class_len) {
       res.success = 0;
-      SET_STRING_ELT(VECTOR_ELT(res.message, 0),  0, mkChar("inherit"));
-      SET_STRING_ELT(
-        VECTOR_ELT(res.message, 0),  1,
-        mkChar(
-          CSR_smprintf4(
-            set.nchar_max, "from class \"%s\"",
-            CHAR(STRING_ELT(target, tar_class_i)), "", "", ""
-  ) ) );} }
+      res.message = ALIKEC_res_msg_def(
+        "inherit",
+        CSR_smprintf4(
+          set.nchar_max, "from class \"%s\"",
+          CHAR(STRING_ELT(target, tar_class_i)), "", "", ""
+        ),
+        "", ""
+      );
+  } }
   // Make sure class attributes are alike
 
   if(res.success) {
-    UNPROTECT(1);
-    res = 
+    res =
       ALIKEC_alike_attr(ATTRIB(target), ATTRIB(current), R_ClassSymbol, set);
-    PROTECT(res.message);
   }
-  UNPROTECT(1);
   res.df = is_df;
   return res;
 }
@@ -245,10 +270,7 @@ SEXP ALIKEC_compare_class_ext(SEXP target, SEXP current) {
   struct ALIKEC_res_sub res = ALIKEC_compare_class(
     target, current, VALC_settings_init()
   );
-  PROTECT(res.message);
-  SEXP res_sxp = ALIKEC_res_sub_as_sxp(res);
-  UNPROTECT(1);
-  return res_sxp;
+  return ALIKEC_res_sub_as_sxp(res);
 }
 /*-----------------------------------------------------------------------------\
 \-----------------------------------------------------------------------------*/
@@ -440,13 +462,8 @@ names.
 struct ALIKEC_res_sub ALIKEC_compare_special_char_attrs_internal(
   SEXP target, SEXP current, struct VALC_settings set, int strict
 ) {
-  // We're playing with fire a little with PROTECT since we're not actually
-  // PROTECTing the result of ALIKEC_res_msg_def in most cases to avoid
-  // having to keep the stack balance across all branches; in theory the code
-  // returns before there should be any gc happening
-
   struct ALIKEC_res res = ALIKEC_alike_internal(target, current, set);
-  PROTECT(res.message);
+  PROTECT(res.message.wrap);
   struct ALIKEC_res_sub res_sub = ALIKEC_res_sub_def();
 
   // Special character attributes must be alike; not sure the logic here is
@@ -476,36 +493,38 @@ struct ALIKEC_res_sub ALIKEC_compare_special_char_attrs_internal(
         );
       }
     } else if (tar_type == STRSXP) {
-      // Only determine what name is wrong if we know there is a mismatch since
-      // we have to loop thorugh each value.  Zero length targets match anything
-      // unless in strict mode
+      // Zero length strings in targets match anything unless in strict mode.
+      // This is a single pass since matching CHARSXPs are usually the same
+      // object, the attributes were already compared by `alike` above.
 
-      if(!R_compute_identical(target, current, 16)) {
+      if(target != current) {
         for(i = (R_xlen_t) 0; i < tar_len; i++) {
-          const char * cur_name_val = CHAR(STRING_ELT(current, i));
-          const char * tar_name_val = CHAR(STRING_ELT(target, i));
+          SEXP cur_name_chr = STRING_ELT(current, i);
+          SEXP tar_name_chr = STRING_ELT(target, i);
+          if(cur_name_chr == tar_name_chr) continue;
+          const char * cur_name_val = CHAR(cur_name_chr);
+          const char * tar_name_val = CHAR(tar_name_chr);
           if(         // check dimnames names match
             (strict || tar_name_val[0]) &&
-            strcmp(tar_name_val, cur_name_val) != 0
+            !ALIKEC_chr_eq(tar_name_chr, cur_name_chr)
           ) {
             res_sub.success=0;
-            res_sub.message = PROTECT(
-              ALIKEC_res_msg_def(
-                "be",
-                CSR_smprintf4(
-                  set.nchar_max, "\"%s\"", tar_name_val, "", "", ""
-                ),
-                "is",
-                CSR_smprintf4(
-                  set.nchar_max, "\"%s\"", cur_name_val, "", "", ""
-            ) ) );
+            res_sub.message = ALIKEC_res_msg_def(
+              "be",
+              CSR_smprintf4(
+                set.nchar_max, "\"%s\"", tar_name_val, "", "", ""
+              ),
+              "is",
+              CSR_smprintf4(
+                set.nchar_max, "\"%s\"", cur_name_val, "", "", ""
+            ) );
             SEXP wrap = PROTECT(allocVector(VECSXP, 2));
             SET_VECTOR_ELT(wrap, 0,
               lang3(R_BracketSymbol, R_NilValue, ScalarReal(i + 1))
             );
             SET_VECTOR_ELT(wrap, 1, CDR(VECTOR_ELT(wrap, 0)));
-            SET_VECTOR_ELT(res_sub.message, 1, wrap);
-            UNPROTECT(2);
+            res_sub.message.wrap = wrap;
+            UNPROTECT(1);
             break;
       } } }
     } else {
@@ -523,10 +542,7 @@ SEXP ALIKEC_compare_special_char_attrs(SEXP target, SEXP current) {
   struct ALIKEC_res_sub res = ALIKEC_compare_special_char_attrs_internal(
     target, current, VALC_settings_init(), 0
   );
-  PROTECT(res.message);
-  SEXP res_sexp = PROTECT(ALIKEC_res_sub_as_sxp(res));
-  UNPROTECT(2);
-  return res_sexp;
+  return ALIKEC_res_sub_as_sxp(res);
 }
 /*-----------------------------------------------------------------------------\
 \-----------------------------------------------------------------------------*/
@@ -574,20 +590,15 @@ struct ALIKEC_res_sub ALIKEC_compare_dimnames(
     ((prim_len = XLENGTH(prim)) && prim_len != (sec_len = XLENGTH(sec)))
   ) {
     struct ALIKEC_res res_tmp = ALIKEC_alike_internal(prim, sec, set);
-    PROTECT(res_tmp.message);
-    if(!res_tmp.success) {
+    PROTECT(res_tmp.message.wrap);
+    if(!res_tmp.success && set.no_msg) {
+      res.success = 0;
+    } else if(!res_tmp.success) {
       // Need to re-wrap the original error message
       res.success = 0;
       res.message = res_tmp.message;
-      SEXP res_wrap_old = VECTOR_ELT(res.message, 1);
       SEXP res_call = PROTECT(lang2(R_DimNamesSymbol, R_NilValue));
-
-      if(VECTOR_ELT(res_wrap_old, 1) == R_NilValue) {
-        SET_VECTOR_ELT(res_wrap_old, 0, res_call);
-      } else {
-        SETCAR(VECTOR_ELT(res_wrap_old, 1), res_call);
-      }
-      SET_VECTOR_ELT(res_wrap_old, 1, CDR(res_call));
+      res.message.wrap = ALIKEC_wrap_around(res.message.wrap, res_call);
       UNPROTECT(1);
     }
     UNPROTECT(1);
@@ -627,28 +638,21 @@ struct ALIKEC_res_sub ALIKEC_compare_dimnames(
           CAR(prim_attr_cpy), CAR(sec_attr_cpy), set
         );
         if(!res_tmp.success) {
-          PROTECT(res_tmp.message); // not really necessary since unused
           res.success = 0;
-          res.message = PROTECT(
-            ALIKEC_res_msg_def(
-              "be",  "`alike` the corresponding element in target", "", ""
-          ) );
-          SEXP wrap = PROTECT(ALIKEC_compare_dimnames_wrap(prim_tag));
-          SET_VECTOR_ELT(res.message, 1, wrap);
-          UNPROTECT(3);
+          res.message = ALIKEC_res_msg_def(
+            "be",  "`alike` the corresponding element in target", "", ""
+          );
+          res.message.wrap = ALIKEC_compare_dimnames_wrap(prim_tag);
           return res;
         }
         do_continue = 1;
-        res_tmp.message = R_NilValue;
         break;
     } }
     if(do_continue) continue;
     // missing attribute
     res.success = 0;
-    res.message = PROTECT(ALIKEC_res_msg_def("not be", "missing", "", ""));
-    SEXP wrap = PROTECT(ALIKEC_compare_dimnames_wrap(prim_tag));
-    SET_VECTOR_ELT(res.message, 1, wrap);
-    UNPROTECT(2);
+    res.message = ALIKEC_res_msg_def("not be", "missing", "", "");
+    res.message.wrap = ALIKEC_compare_dimnames_wrap(prim_tag);
     return res;
   }
   // Compare actual dimnames attr
@@ -660,14 +664,15 @@ struct ALIKEC_res_sub ALIKEC_compare_dimnames(
   if(prim_names != R_NilValue) {
     struct ALIKEC_res_sub dimnames_name_comp =
       ALIKEC_compare_special_char_attrs_internal(prim_names, sec_names, set, 0);
+    if(!dimnames_name_comp.success && set.no_msg) return dimnames_name_comp;
     if(!dimnames_name_comp.success) {
-      PROTECT(dimnames_name_comp.message);
+      PROTECT(dimnames_name_comp.message.wrap);
       // re-wrap in names(dimnames())
-      SEXP wrap = VECTOR_ELT(dimnames_name_comp.message, 1);
+      SEXP wrap = dimnames_name_comp.message.wrap;
       SEXP wrap_call = PROTECT(
         lang2(R_NamesSymbol, lang2(R_DimNamesSymbol, R_NilValue))
       );
-      if(VECTOR_ELT(wrap, 0) == R_NilValue) {
+      if(wrap == R_NilValue || VECTOR_ELT(wrap, 0) == R_NilValue) {
         // nocov start
         // All of these errors are going to have some `[x]` accessor, only way
         // would be if were using integer names, but that is not actually
@@ -681,14 +686,11 @@ struct ALIKEC_res_sub ALIKEC_compare_dimnames(
         // If we did hit this case, then the following would be how to handle it
         // SET_VECTOR_ELT(wrap, 0, wrap_call);
         // nocov end
-      } else {
-        SETCAR(VECTOR_ELT(wrap, 1), wrap_call);
       }
-      SET_VECTOR_ELT(wrap, 1, CDR(CADR(wrap_call)));
+      ALIKEC_wrap_around_at(wrap, wrap_call, CDR(CADR(wrap_call)));
       UNPROTECT(2);
       return dimnames_name_comp;
     }
-    dimnames_name_comp.message = R_NilValue;
   }
   // look at dimnames themselves
 
@@ -703,9 +705,9 @@ struct ALIKEC_res_sub ALIKEC_compare_dimnames(
         ALIKEC_compare_special_char_attrs_internal(
           prim_obj, sec_obj, set, 0
         );
+      if(!dimnames_comp.success && set.no_msg) return dimnames_comp;
       if(!dimnames_comp.success) {
-        PROTECT(dimnames_comp.message);
-        SEXP wrap = VECTOR_ELT(dimnames_comp.message, 1);
+        PROTECT(dimnames_comp.message.wrap);
         SEXP wrap_call, wrap_ref;
 
         if(prim_len == 2) { // matrix like
@@ -728,12 +730,9 @@ struct ALIKEC_res_sub ALIKEC_compare_dimnames(
           ) );
           wrap_ref = CDR(CADR(wrap_call));
         }
-        if(VECTOR_ELT(wrap, 0) != R_NilValue) {
-          SETCAR(VECTOR_ELT(wrap, 1), wrap_call);
-        } else {
-          SET_VECTOR_ELT(wrap, 0, wrap_call);
-        }
-        SET_VECTOR_ELT(wrap, 1, wrap_ref);
+        dimnames_comp.message.wrap = ALIKEC_wrap_around_at(
+          dimnames_comp.message.wrap, wrap_call, wrap_ref
+        );
         UNPROTECT(2);
         return dimnames_comp;
   } } }
@@ -770,17 +769,16 @@ struct ALIKEC_res_sub ALIKEC_compare_ts(
         char * cur_num = R_alloc(21, sizeof(char));
         snprintf(tar_num, 20, "%g", tar_real[i]);
         snprintf(cur_num, 20, "%g", cur_real[i]);
-        res.message = PROTECT(
-          ALIKEC_res_msg_def(
-            "be",
-            CSR_smprintf4(
-              set.nchar_max, "%s", tar_num, "", "", ""
-            ),
-            "is",
-            CSR_smprintf4(
-              set.nchar_max, "%s", cur_num, "", "", ""
-            )
-        ) );
+        res.message = ALIKEC_res_msg_def(
+          "be",
+          CSR_smprintf4(
+            set.nchar_max, "%s", tar_num, "", "", ""
+          ),
+          "is",
+          CSR_smprintf4(
+            set.nchar_max, "%s", cur_num, "", "", ""
+          )
+        );
         SEXP wrap = PROTECT(allocVector(VECSXP, 2));
         SET_VECTOR_ELT(
           wrap, 0, lang3(
@@ -788,8 +786,8 @@ struct ALIKEC_res_sub ALIKEC_compare_ts(
             ScalarReal(i + 1)
         ) );
         SET_VECTOR_ELT(wrap, 1, CDR(CADR(VECTOR_ELT(wrap, 0))));
-        SET_VECTOR_ELT(res.message, 1, wrap);
-        UNPROTECT(2);
+        res.message.wrap = wrap;
+        UNPROTECT(1);
         return res;
     } }
   } else {
@@ -817,11 +815,11 @@ struct ALIKEC_res_sub  ALIKEC_compare_levels(
     struct ALIKEC_res_sub res = ALIKEC_compare_special_char_attrs_internal(
       target, current, set, 0
     );
-    PROTECT(res.message);
-    if(!res.success) {
-      ALIKEC_wrap_around(
-        VECTOR_ELT(res.message, 1), lang2(R_LevelsSymbol, R_NilValue)
-      );
+    PROTECT(res.message.wrap);
+    if(!res.success && !set.no_msg) {
+      SEXP call = PROTECT(lang2(R_LevelsSymbol, R_NilValue));
+      res.message.wrap = ALIKEC_wrap_around(res.message.wrap, call);
+      UNPROTECT(1);
     }
     UNPROTECT(1);
     return res;
@@ -871,63 +869,99 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal_simple(
 
   if(tae_type == NILSXP || cae_type == NILSXP) {
     res.success = 0;
-    res.message = PROTECT(
-      ALIKEC_res_msg_def(
-        CSR_smprintf4(
-          set.nchar_max, "%shave",
-          tae_type == NILSXP ? "not " : "", "", "", ""
-        ),
-        CSR_smprintf4(
-          set.nchar_max, "attribute \"%s\"",
-          CHAR(PRINTNAME(attr_sym)), "", "", ""
-        ),
-        "", ""
-    ) );
+    res.message = ALIKEC_res_msg_def(
+      CSR_smprintf4(
+        set.nchar_max, "%shave",
+        tae_type == NILSXP ? "not " : "", "", "", ""
+      ),
+      CSR_smprintf4(
+        set.nchar_max, "attribute \"%s\"",
+        CHAR(PRINTNAME(attr_sym)), "", "", ""
+      ),
+      "", ""
+    );
   } else if(tae_type != cae_type) {
     res.success = 0;
-    res.message = PROTECT(
-      ALIKEC_res_msg_def(
+    res.message = ALIKEC_res_msg_def(
+      "be",
+      CSR_smprintf4(
+        set.nchar_max, "%s", type2char(tae_type), "", "", ""
+      ),
+      "is",
+      CSR_smprintf4(
+        set.nchar_max, "%s", type2char(cae_type), "", "", ""
+      )
+    );
+    res.message.wrap = ALIKEC_attr_wrap(attr_sym, R_NilValue);
+  } else if (tae_val_len != cae_val_len) {
+    if(set.attr_mode || tae_val_len) {
+      res.success = 0;
+      res.message = ALIKEC_res_msg_def(
         "be",
         CSR_smprintf4(
-          set.nchar_max, "%s", type2char(tae_type), "", "", ""
+          set.nchar_max, "%s", CSR_len_as_chr(tae_val_len), "", "", ""
         ),
         "is",
         CSR_smprintf4(
-          set.nchar_max, "%s", type2char(cae_type), "", "", ""
+          set.nchar_max, "%s", CSR_len_as_chr(cae_val_len), "", "", ""
         )
-    ) );
-    SEXP wrap = PROTECT(ALIKEC_attr_wrap(attr_sym, R_NilValue));
-    SET_VECTOR_ELT(res.message, 1, wrap);
-    UNPROTECT(1);
-  } else if (tae_val_len != cae_val_len) {
-    if(set.attr_mode || tae_val_len) {
-      res.success = 0;
-      res.message = PROTECT(
-        ALIKEC_res_msg_def(
-          "be",
-          CSR_smprintf4(
-            set.nchar_max, "%s", CSR_len_as_chr(tae_val_len), "", "", ""
-          ),
-          "is",
-          CSR_smprintf4(
-            set.nchar_max, "%s", CSR_len_as_chr(cae_val_len), "", "", ""
-          )
-      ) );
+      );
       SEXP wrap = PROTECT(ALIKEC_attr_wrap(attr_sym, R_NilValue));
       SET_VECTOR_ELT(
         wrap, 0,
         lang2(ALIKEC_SYM_length, VECTOR_ELT(wrap, 0))
       );
-      SET_VECTOR_ELT(res.message, 1, wrap);
+      res.message.wrap = wrap;
       UNPROTECT(1);
     }
   } else {
     res = ALIKEC_alike_attr(target, current, attr_sym, set);
-    PROTECT(res.message);
   }
-  UNPROTECT(1);
   return res;
 }
+/*
+Lookup table for attribute pairlists keyed on the TAG symbol pointers.
+
+Symbols are unique so pointer equality is all we need.  Memory is `R_alloc`ed
+so there is no need to free it.
+*/
+struct ALIKEC_attr_hash {
+  size_t mask;  // zero if table not in use
+  SEXP * tags;
+  SEXP * els;
+};
+static size_t ALIKEC_attr_hash_idx(SEXP tag, size_t mask) {
+  uintptr_t hash = (uintptr_t) tag >> 4;
+  return (size_t) ((hash * (uintptr_t) 2654435761U) & mask);
+}
+static void ALIKEC_attr_hash_init(
+  struct ALIKEC_attr_hash * tbl, SEXP attr, size_t count
+) {
+  size_t cap = 8;
+  while(cap < 2 * count) cap <<= 1;
+
+  tbl->mask = cap - 1;
+  tbl->tags = (SEXP *) R_alloc(cap, sizeof(SEXP));
+  tbl->els = (SEXP *) R_alloc(cap, sizeof(SEXP));
+  for(size_t i = 0; i < cap; ++i) tbl->tags[i] = NULL;
+
+  for(SEXP el = attr; el != R_NilValue; el = CDR(el)) {
+    SEXP tag = TAG(el);
+    size_t i = ALIKEC_attr_hash_idx(tag, tbl->mask);
+    while(tbl->tags[i] && tbl->tags[i] != tag) i = (i + 1) & tbl->mask;
+    if(!tbl->tags[i]) {  // first wins, as with the linear scan
+      tbl->tags[i] = tag;
+      tbl->els[i] = el;
+  } }
+}
+static SEXP ALIKEC_attr_hash_get(struct ALIKEC_attr_hash * tbl, SEXP tag) {
+  size_t i = ALIKEC_attr_hash_idx(tag, tbl->mask);
+  while(tbl->tags[i]) {
+    if(tbl->tags[i] == tag) return tbl->els[i];
+    i = (i + 1) & tbl->mask;
+  }
+  return R_NilValue;
+}
 /* Used by alike to compare attributes;
 
 Code originally inspired by `R_compute_identical` (thanks R CORE)
@@ -979,9 +1013,8 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
     sec_attr = tar_attr;
     if(set.attr_mode == 2) {
       errs[7].success = 0;
-      errs[7].message =
-        PROTECT(ALIKEC_res_msg_def("have", "attributes", "", ""));
-    } else PROTECT(R_NilValue);
+      errs[7].message = ALIKEC_res_msg_def("have", "attributes", "", "");
+    }
   } else {
     prim_attr = tar_attr;
     sec_attr = cur_attr;
@@ -992,21 +1025,13 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
        // if the only attribute in `tar_attr` is srcref then it is okay that
        // `cur_attr` is NULL
        !(
-         !strcmp(CHAR(PRINTNAME(TAG(prim_attr))), "srcref") &&
-         CDR(prim_attr) == R_NilValue
+         TAG(prim_attr) == R_SrcrefSymbol && CDR(prim_attr) == R_NilValue
       ) )
     ) {
       errs[7].success = 0;
-      errs[7].message = PROTECT(
-        ALIKEC_res_msg_def(
-          "have",
-          "attributes",
-          "has",
-          "none"
-      ) );
-    } else PROTECT(R_NilValue);
+      errs[7].message = ALIKEC_res_msg_def("have", "attributes", "has", "none");
+    }
   }
-  ps++;
   /*
   Mark that we're in attribute checking so we can handle recursions within
   attributes properly
@@ -1014,14 +1039,10 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
   set.in_attr++;
 
   /*
-  Loop through all attr combinations; maybe could be made faster by reducing the
-  second loop each time a match is found, though this would require duplication
-  of the attributes (likely faster for items with lots of attributes, but slower
-  for those with few; ideally need a way to duplicate the LISTSXP but not the
-  contents - I guess wouldn't be too hard to implement).
-
-  Alternate: use hash tables, though likely not worth it unless more than 25
-  attributes, which should be rare
+  Loop through all attr combinations.  For the common case of a handful of
+  attributes the nested pairlist scan is fastest, but it is quadratic so once
+  the secondary object has ALIKEC_ATTR_HASH_MIN or more attributes we instead
+  look up matches in a table keyed on the tag symbol pointers.
   */
   /*
   Here we need to `rev` so that our double loop works; if we don't rev and
@@ -1031,27 +1052,51 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
   */
   SEXP prim_attr_el, sec_attr_el;
   size_t sec_attr_counted = 0, sec_attr_count = 0, prim_attr_count = 0;
+  struct ALIKEC_attr_hash sec_hash = {0, NULL, NULL};
+
+  // Without messages any error that will be reported is as good as any other
+  // so we can stop at the first one
+
+  int errs_report = set.no_msg && (!rev || set.attr_mode == 2);
 
   for(
     prim_attr_el = prim_attr; prim_attr_el != R_NilValue;
     prim_attr_el = CDR(prim_attr_el)
   ) {
+    if(errs_report) {
+      int errs_any = 0;
+      for(int j = 0; j < 8; ++j) errs_any |= !errs[j].success;
+      if(errs_any) break;
+    }
     SEXP prim_tag = TAG(prim_attr_el);
     const char * tx = CHAR(PRINTNAME(prim_tag));
     prim_attr_count++;
     SEXP sec_attr_el_tmp = R_NilValue;
 
-    for(
-      sec_attr_el = sec_attr; sec_attr_el != R_NilValue;
-      sec_attr_el = CDR(sec_attr_el)
-    ) {
-      if(!sec_attr_counted) sec_attr_count++;
-      if(prim_tag == TAG(sec_attr_el)) {
-        sec_attr_el_tmp = sec_attr_el;
-        // Don't need to do full loop since we did it once already
-        if(sec_attr_counted) break;
-    } }
-    sec_attr_counted = 1;
+    if(!sec_attr_counted) {
+      for(
+        sec_attr_el = sec_attr; sec_attr_el != R_NilValue;
+        sec_attr_el = CDR(sec_attr_el)
+      ) sec_attr_count++;
+      sec_attr_counted = 1;
+      // Only worth building the table if we'll do more than one lookup
+      if(
+        sec_attr_count >= ALIKEC_ATTR_HASH_MIN &&
+        CDR(prim_attr_el) != R_NilValue
+      )
+        ALIKEC_attr_hash_init(&sec_hash, sec_attr, sec_attr_count);
+    }
+    if(sec_hash.mask) {
+      sec_attr_el_tmp = ALIKEC_attr_hash_get(&sec_hash, prim_tag);
+    } else {
+      for(
+        sec_attr_el = sec_attr; sec_attr_el != R_NilValue;
+        sec_attr_el = CDR(sec_attr_el)
+      ) {
+        if(prim_tag == TAG(sec_attr_el)) {
+          sec_attr_el_tmp = sec_attr_el;
+          break;
+    } } }
     sec_attr_el = sec_attr_el_tmp;
 
     if(prim_attr_el == R_NilValue) { // NULL attrs shouldn't be possible
@@ -1078,8 +1123,7 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
     // No match only matters if target has attrs and is not `srcref`, or in
     // strict mode
 
-    int is_srcref =
-      tar_tag != R_NilValue && !strcmp(CHAR(PRINTNAME(tar_tag)), "srcref");
+    int is_srcref = tar_tag == R_SrcrefSymbol;
     if(
       (
         (tar_attr_el == R_NilValue && set.attr_mode == 2) ||
@@ -1087,16 +1131,14 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
       ) && errs[7].success
     ) {
       errs[7].success = 0;
-      errs[7].message = PROTECT(
-        ALIKEC_res_msg_def(
-          CSR_smprintf4(
-            set.nchar_max, "%shave",
-            (cur_attr_el == R_NilValue ? "" : "not "), "", "", ""
-          ),
-          CSR_smprintf4(set.nchar_max, "attribute \"%s\"", tx, "", "", ""),
-          "", ""
-      ) );
-      ps++;
+      errs[7].message = ALIKEC_res_msg_def(
+        CSR_smprintf4(
+          set.nchar_max, "%shave",
+          (cur_attr_el == R_NilValue ? "" : "not "), "", "", ""
+        ),
+        CSR_smprintf4(set.nchar_max, "attribute \"%s\"", tx, "", "", ""),
+        "", ""
+      );
     } else if (is_srcref && !set.attr_mode) {
       // Don't check srcref if in default attribute mode
       continue;
@@ -1110,7 +1152,7 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
       res_sub = ALIKEC_compare_attributes_internal_simple(
         tar_attr_el_val, cur_attr_el_val, prim_tag, set
       );
-      PROTECT(res_sub.message); ps++;
+      PROTECT(res_sub.message.wrap); ps++;
       errs[6] = res_sub;
 
     // = Custom Checks =========================================================
@@ -1133,7 +1175,7 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
         struct ALIKEC_res_sub class_comp = ALIKEC_compare_class(
           tar_attr_el_val_tmp, cur_attr_el_val_tmp, set
         );
-        PROTECT(class_comp.message);
+        PROTECT(class_comp.message.wrap);
         ps += 3;
         is_df = class_comp.df;
         errs[0] = class_comp;
@@ -1146,18 +1188,21 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
           ALIKEC_compare_special_char_attrs_internal(
             tar_attr_el_val, cur_attr_el_val, set, 0
           );
-        PROTECT(name_comp.message); ps++;
-        if(!name_comp.success) {
+        PROTECT(name_comp.message.wrap); ps++;
+        if(!name_comp.success && set.no_msg) {
+          errs[tar_tag == R_NamesSymbol ? 3 : 4] = name_comp;
+        } else if(!name_comp.success) {
           int is_names = tar_tag == R_NamesSymbol;
           int err_ind = is_names ? 3 : 4;
           errs[err_ind] = name_comp;
 
           // wrap original wrap in names/rownames
 
-          SEXP wrap_orig = VECTOR_ELT(errs[err_ind].message, 1);
           SEXP call = PROTECT(lang2(tar_tag, R_NilValue));
-          ALIKEC_wrap_around(wrap_orig, call); // modifies wrap_orig
+          errs[err_ind].message.wrap =
+            ALIKEC_wrap_around(errs[err_ind].message.wrap, call);
           UNPROTECT(1);
+          PROTECT(errs[err_ind].message.wrap); ps++;
         }
         continue;
       // - Dims ----------------------------------------------------------------
@@ -1168,7 +1213,7 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
         struct ALIKEC_res_sub dim_comp = ALIKEC_compare_dims(
           tar_attr_el_val, cur_attr_el_val, target, current, set
         );
-        PROTECT(dim_comp.message); ps++;
+        PROTECT(dim_comp.message.wrap); ps++;
 
         // implicit class error upgrades to major error
 
@@ -1181,7 +1226,7 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
         struct ALIKEC_res_sub dimname_comp = ALIKEC_compare_dimnames(
           tar_attr_el_val, cur_attr_el_val, set
         );
-        PROTECT(dimname_comp.message); ps++;
+        PROTECT(dimname_comp.message.wrap); ps++;
         errs[5] = dimname_comp;
 
       // - levels --------------------------------------------------------------
@@ -1190,7 +1235,7 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
         struct ALIKEC_res_sub levels_comp = ALIKEC_compare_levels(
           tar_attr_el_val, cur_attr_el_val, set
         );
-        PROTECT(levels_comp.message); ps++;
+        PROTECT(levels_comp.message.wrap); ps++;
         errs[6] = levels_comp;
 
       // - tsp -----------------------------------------------------------------
@@ -1200,7 +1245,7 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
         struct ALIKEC_res_sub ts_comp = ALIKEC_compare_ts(
           tar_attr_el_val, cur_attr_el_val, set
         );
-        PROTECT(ts_comp.message); ps++;
+        PROTECT(ts_comp.message.wrap); ps++;
         errs[1] = ts_comp;
 
       // - normal attrs --------------------------------------------------------
@@ -1210,7 +1255,7 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
           ALIKEC_compare_attributes_internal_simple(
             tar_attr_el_val, cur_attr_el_val, prim_tag, set
           );
-        PROTECT(attr_comp.message); ps++;
+        PROTECT(attr_comp.message.wrap); ps++;
         errs[6] = attr_comp;
       }
   } }
@@ -1218,20 +1263,18 @@ struct ALIKEC_res_sub ALIKEC_compare_attributes_internal(
 
   if(set.attr_mode == 2 && prim_attr_count != sec_attr_count) {
     errs[7].success = 0;
-    errs[7].message = PROTECT(
-      ALIKEC_res_msg_def(
-        "have",
-        CSR_smprintf4(
-          set.nchar_max, "%s attribute%s",
-          CSR_len_as_chr(prim_attr_count),
-          prim_attr_count != 1 ? "s" : "", "", ""
-        ),
-        "has",
-        CSR_smprintf4(
-          set.nchar_max, "%s", CSR_len_as_chr(sec_attr_count), "", "", ""
-        )
-    ) );
-    ps++;
+    errs[7].message = ALIKEC_res_msg_def(
+      "have",
+      CSR_smprintf4(
+        set.nchar_max, "%s attribute%s",
+        CSR_len_as_chr(prim_attr_count),
+        prim_attr_count != 1 ? "s" : "", "", ""
+      ),
+      "has",
+      CSR_smprintf4(
+        set.nchar_max, "%s", CSR_len_as_chr(sec_attr_count), "", "", ""
+      )
+    );
   }
   // Now determine which error to throw, if any
 
@@ -0,0 +1,347 @@
+/*
+Copyright (C) 2017  Brodie Gaslam
+
+This file is part of "vetr - Trust, but Verify"
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
+*/
+
+#include "validate.h"
+
+/*
+ * Cache of compiled vetting programs.
+ *
+ * Vetting expressions are almost always literals in function bodies, so the
+ * SEXP handed to `VALC_evaluate` is the same object call after call.  We use
+ * its pointer as the key to a direct mapped table.  Since programs are
+ * compiled with a placeholder for `.` they do not depend on the argument
+ * being vetted.  They do depend on the environment via the symbols the parse
+ * substitutes (e.g. `INT.1` -> `integer(1L) && NO.NA && NO.INF`), and that
+ * environment is typically a new function frame on each call, so instead of
+ * keying on it we record every symbol lookup the parse performed along with
+ * what it resolved to, and re-check those lookups against the current
+ * environment on each hit.  If any of them resolves to something different
+ * the entry is stale and we re-compile.
+ *
+ * Each slot in the table is a VECSXP:
+ *
+ * 0. the vetting expression (key)
+ * 1. the compiled program, see compile.c
+ * 2. a pairlist of the symbol lookups, see `VALC_parse_dep_add`
+ *
+ * The compiler also records here the functions that template calls resolved
+ * to when it decides to memoize them (see `VALC_tpl_pure` in compile.c).
+ */
+#define VALC_PARSE_CACHE_SIZE 1024
+
+#define VALC_PLAN_CACHE_SIZE 256
+
+static SEXP VALC_parse_cache;
+static SEXP VALC_plan_cache;
+static double VALC_parse_cache_hits;
+static double VALC_parse_cache_misses;
+static double VALC_parse_cache_stale;
+
+void VALC_parse_cache_init() {
+  VALC_parse_cache = allocVector(VECSXP, VALC_PARSE_CACHE_SIZE);
+  R_PreserveObject(VALC_parse_cache);
+  VALC_plan_cache = allocVector(VECSXP, VALC_PLAN_CACHE_SIZE);
+  R_PreserveObject(VALC_plan_cache);
+  VALC_parse_cache_hits = VALC_parse_cache_misses = VALC_parse_cache_stale = 0;
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * Prevent in place modification of objects whose identity we rely on, as
+ * otherwise a modified object would look like the one we cached.
+ */
+void VALC_not_mutable(SEXP x) {
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 5, 0)
+  MARK_NOT_MUTABLE(x);
+#else
+  SET_NAMED(x, 2);
+#endif
+}
+/*
+ * What we need to record about the value a symbol resolved to: the value
+ * itself if it is language (which means it was substituted) or a compiled
+ * program, and NULL otherwise as the parse only cares about whether the
+ * symbol resolves to language or not.
+ */
+static SEXP VALC_dep_val(SEXP val) {
+  SEXPTYPE val_type = TYPEOF(val);
+  if(val_type == LANGSXP || val_type == SYMSXP || VALC_is_prog(val))
+    return val;
+  return R_NilValue;
+}
+/*
+ * Record the outcome of a symbol lookup performed during the parse.
+ *
+ * `deps` is a sentinel cons cell; lookups are prepended to its CDR and are put
+ * back in lookup order once the parse completes.
+ */
+void VALC_parse_dep_add(SEXP deps, SEXP symb, SEXP val) {
+  if(deps == R_NilValue) return;
+  val = VALC_dep_val(val);
+  if(TYPEOF(val) == LANGSXP) VALC_not_mutable(val);
+
+  SETCDR(deps, CONS(val, CDR(deps)));
+  SET_TAG(CDR(deps), symb);
+}
+/*
+ * Record a function lookup.  Since `VALC_dep_val` never returns functions
+ * these can be told apart from the symbol lookups.
+ */
+void VALC_parse_dep_fun_add(SEXP deps, SEXP symb, SEXP fun) {
+  if(deps == R_NilValue) return;
+  SETCDR(deps, CONS(fun, CDR(deps)));
+  SET_TAG(CDR(deps), symb);
+}
+/*
+ * Check that the recorded symbol lookups still resolve to the same thing.
+ *
+ * This mirrors the lookup in `VALC_sub_symbol`, including the `eval` so that
+ * promises are forced and errors are issued as they would have been.
+ */
+static int VALC_parse_deps_valid(SEXP deps, SEXP rho) {
+  for(; deps != R_NilValue; deps = CDR(deps)) {
+    SEXP symb = TAG(deps), val = R_NilValue;
+
+    if(isFunction(CAR(deps))) {
+      if(VALC_find_fun(symb, rho) != CAR(deps)) return 0;
+      continue;
+    }
+    if(findVar(symb, rho) != R_UnboundValue)
+      val = VALC_dep_val(eval(symb, rho));
+    if(val != CAR(deps)) return 0;
+  }
+  return 1;
+}
+static R_xlen_t VALC_parse_cache_idx(SEXP lang) {
+  uintptr_t hash = (uintptr_t) lang >> 4;
+  hash ^= hash >> 10;
+  return (R_xlen_t) (hash % VALC_PARSE_CACHE_SIZE);
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * Retrieve the compiled program for a vetting expression, compiling it if
+ * needed.
+ *
+ * If the vetting expression is a symbol bound to a compiled program (see
+ * `vet_compile`), that program is used directly.
+ *
+ * Programs must be treated as read-only by callers since they may be
+ * returned again on subsequent calls.
+ */
+SEXP VALC_compile_cached(SEXP lang, struct VALC_settings set) {
+  if(VALC_is_prog(lang)) return lang;
+
+  R_xlen_t idx = VALC_parse_cache_idx(lang);
+  SEXP entry = VECTOR_ELT(VALC_parse_cache, idx);
+
+  if(entry != R_NilValue && VECTOR_ELT(entry, 0) == lang) {
+    if(VALC_parse_deps_valid(VECTOR_ELT(entry, 2), set.env)) {
+      VALC_parse_cache_hits++;
+      return VECTOR_ELT(entry, 1);
+    }
+    VALC_parse_cache_stale++;
+  } else VALC_parse_cache_misses++;
+
+  SEXP deps_head = PROTECT(CONS(R_NilValue, R_NilValue));
+  SEXP res = R_NilValue;
+
+  if(TYPEOF(lang) == SYMSXP && findVar(lang, set.env) != R_UnboundValue) {
+    SEXP lang_val = eval(lang, set.env);
+    if(VALC_is_prog(lang_val)) {
+      VALC_parse_dep_add(deps_head, lang, lang_val);
+      res = lang_val;
+    }
+  }
+  if(res == R_NilValue) res = VALC_compile(lang, set, deps_head);
+  PROTECT(res);
+
+  // Put the lookups back in the order they happened so that validation
+  // short-circuits in the same order the parse would have
+
+  SEXP deps = CDR(deps_head), deps_rev = R_NilValue, deps_next;
+  while(deps != R_NilValue) {
+    deps_next = CDR(deps);
+    SETCDR(deps, deps_rev);
+    deps_rev = deps;
+    deps = deps_next;
+  }
+  if(TYPEOF(lang) != SYMSXP) VALC_not_mutable(lang);
+
+  entry = PROTECT(allocVector(VECSXP, 3));
+  SET_VECTOR_ELT(entry, 0, lang);
+  SET_VECTOR_ELT(entry, 1, res);
+  SET_VECTOR_ELT(entry, 2, deps_rev);
+  SET_VECTOR_ELT(VALC_parse_cache, idx, entry);
+
+  UNPROTECT(3);
+  return res;
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * Cache of `vetr` plans.
+ *
+ * Which formal each of the `vetr` vetting expressions applies to only depends
+ * on the function and on the `vetr` call.  That call is part of the function
+ * body so it is the same object call after call and we can use its pointer as
+ * the key.  We match it against the formals once and keep the result.  A plan
+ * is a VECSXP:
+ *
+ * 0. the formals of the function
+ * 1. the body of the function
+ * 2. the `vetr` call as it appears in the body (key)
+ * 3. an INTSXP with, for each formal, the index of its vetting expression in
+ *    the matched `vetr` call, or -1 if it has none
+ * 4. the matched `vetr` call
+ *
+ * The compiled programs for the vetting expressions are retrieved from the
+ * program cache by `VALC_evaluate`.
+ */
+static int VALC_plan_valid(SEXP plan, SEXP fun, SEXP val_call_raw) {
+  return
+    VECTOR_ELT(plan, 2) == val_call_raw &&
+    VECTOR_ELT(plan, 0) == FORMALS(fun) && VECTOR_ELT(plan, 1) == BODY(fun);
+}
+/*
+ * Match the `vetr` call to the function formals with `match.call`, after
+ * dropping the `.VETR_SETTINGS` argument that is for `vetr` itself.
+ */
+static SEXP VALC_plan_match(SEXP fun, SEXP val_call_raw, SEXP fun_frame) {
+  SEXP val_call = PROTECT(shallow_duplicate(val_call_raw)), args;
+  for(args = val_call; CDR(args) != R_NilValue;) {
+    if(TAG(CDR(args)) == VALC_SYM_vetr_set) SETCDR(args, CDDR(args));
+    else args = CDR(args);
+  }
+  SEXP quot_call = PROTECT(lang2(VALC_SYM_quote, val_call));
+  SEXP match_call = PROTECT(
+    lang5(
+      ALIKEC_SYM_matchcall, fun, quot_call, ScalarLogical(1), fun_frame
+  ) );
+  SEXP res = eval(match_call, R_BaseEnv);
+  UNPROTECT(3);
+  return res;
+}
+static SEXP VALC_plan_make(SEXP fun, SEXP val_call_raw, SEXP fun_frame) {
+  SEXP fun_form = FORMALS(fun), args, forms;
+  int form_n = length(fun_form), form_i = 0, i = 0;
+
+  SEXP plan = PROTECT(allocVector(VECSXP, 5));
+  SEXP val_call = PROTECT(VALC_plan_match(fun, val_call_raw, fun_frame));
+  SEXP val_idx = PROTECT(allocVector(INTSXP, form_n));
+
+  for(form_i = 0; form_i < form_n; ++form_i) INTEGER(val_idx)[form_i] = -1;
+
+  // The matched `vetr` call has its arguments in the same order as the formals
+
+  for(
+    args = CDR(val_call), forms = fun_form, form_i = 0; args != R_NilValue;
+    args = CDR(args), ++i
+  ) {
+    while(forms != R_NilValue && TAG(forms) != TAG(args)) {
+      forms = CDR(forms);
+      ++form_i;
+    }
+    if(forms == R_NilValue) {
+      // nocov start
+      error(
+        "%s%s", "Internal Error: validation token does not match formals; ",
+        "contact maintainer."
+      );
+      // nocov end
+    }
+    INTEGER(val_idx)[form_i] = i;
+  }
+  SET_VECTOR_ELT(plan, 0, fun_form);
+  SET_VECTOR_ELT(plan, 1, BODY(fun));
+  SET_VECTOR_ELT(plan, 2, val_call_raw);
+  SET_VECTOR_ELT(plan, 3, val_idx);
+  SET_VECTOR_ELT(plan, 4, val_call);
+  UNPROTECT(3);
+  return plan;
+}
+/*
+ * Retrieve the plan for a `vetr` call, creating it if needed
+ *
+ * @param fun the closure `vetr` is called from
+ * @param val_call_raw the `vetr` call, unmatched
+ * @param fun_frame the frame of `fun`, only used if the `vetr` call needs to be
+ *   matched
+ */
+SEXP VALC_plan_get(SEXP fun, SEXP val_call_raw, SEXP fun_frame) {
+  uintptr_t hash = (uintptr_t) val_call_raw >> 4;
+  R_xlen_t idx = (R_xlen_t) ((hash ^ (hash >> 10)) % VALC_PLAN_CACHE_SIZE);
+  SEXP plan = VECTOR_ELT(VALC_plan_cache, idx);
+
+  if(plan != R_NilValue && VALC_plan_valid(plan, fun, val_call_raw))
+    return plan;
+
+  plan = PROTECT(VALC_plan_make(fun, val_call_raw, fun_frame));
+
+  // If the `vetr` call uses `...` the matched call depends on the dots of
+  // each call so we can't re-use it
+
+  int dots = 0;
+  for(SEXP args = CDR(val_call_raw); args != R_NilValue; args = CDR(args))
+    if((dots = CAR(args) == R_DotsSymbol)) break;
+  if(!dots) SET_VECTOR_ELT(VALC_plan_cache, idx, plan);
+  UNPROTECT(1);
+  return plan;
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * Report, and optionally reset, cache statistics.  `misses` are lookups that
+ * found no matching entry, `stale` are those that found one but had to
+ * re-parse because a substituted symbol resolved differently.
+ */
+SEXP VALC_parse_cache_stats(SEXP reset) {
+  if(
+    TYPEOF(reset) != LGLSXP || XLENGTH(reset) != 1 ||
+    asLogical(reset) == NA_LOGICAL
+  )
+    error("Argument `reset` must be TRUE or FALSE.");
+
+  SEXP res = PROTECT(allocVector(REALSXP, 4));
+  SEXP res_names = PROTECT(allocVector(STRSXP, 4));
+  R_xlen_t i, used = 0;
+
+  for(i = 0; i < VALC_PARSE_CACHE_SIZE; ++i)
+    used += VECTOR_ELT(VALC_parse_cache, i) != R_NilValue;
+
+  REAL(res)[0] = VALC_parse_cache_hits;
+  REAL(res)[1] = VALC_parse_cache_misses;
+  REAL(res)[2] = VALC_parse_cache_stale;
+  REAL(res)[3] = (double) used;
+  SET_STRING_ELT(res_names, 0, mkChar("hits"));
+  SET_STRING_ELT(res_names, 1, mkChar("misses"));
+  SET_STRING_ELT(res_names, 2, mkChar("stale"));
+  SET_STRING_ELT(res_names, 3, mkChar("entries"));
+  setAttrib(res, R_NamesSymbol, res_names);
+
+  if(asLogical(reset)) {
+    for(i = 0; i < VALC_PARSE_CACHE_SIZE; ++i)
+      SET_VECTOR_ELT(VALC_parse_cache, i, R_NilValue);
+    for(i = 0; i < VALC_PLAN_CACHE_SIZE; ++i)
+      SET_VECTOR_ELT(VALC_plan_cache, i, R_NilValue);
+    VALC_parse_cache_hits = VALC_parse_cache_misses = 0;
+    VALC_parse_cache_stale = 0;
+  }
+  UNPROTECT(2);
+  return res;
+}
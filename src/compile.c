@@ -0,0 +1,443 @@
+/*
+Copyright (C) 2017  Brodie Gaslam
+
+This file is part of "vetr - Trust, but Verify"
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
+*/
+
+#include "validate.h"
+
+/*
+ * Compile the output of `VALC_parse` into a flat program.
+ *
+ * The parse produces two parallel trees, the substituted language and the
+ * mode codes (1: `&&`, 2: `||`, 10: evaluate as is, 999: template).  Here we
+ * flatten them into an array of `struct VALC_op` where the `&&` and `||` nodes
+ * become conditional jumps and the leaves reference the expression to
+ * evaluate by index.  `VALC_run` in eval.c executes the program.
+ *
+ * `x && y` becomes:
+ *
+ *     <x>; AND (jump to end if failed); <y>; end:
+ *
+ * `x || y` becomes:
+ *
+ *     OR_INIT; <x>; OR (jump to OR_END if passed); <y>; OR_END
+ *
+ * OR_INIT records how many errors have accumulated so that OR_END can drop
+ * the errors produced by the failing branch if the other one passed.
+ *
+ * The ops are stored in an INTSXP so that they are protected along with the
+ * rest of the program data, and the external pointer address is set to the
+ * data of that INTSXP.  The external pointer protected value is a VECSXP:
+ *
+ * 0. the uncompiled vetting expression
+ * 1. the parsed language
+ * 2. a VECSXP with the leaf expressions, `.` substituted with `VALC_SYM_arg`
+ * 3. the INTSXP with the `struct VALC_prog` data
+ * 4. a VECSXP with the memoized values of pure template leaves, see
+ *    `VALC_tpl_pure`, and the constant operand of comparison kernel leaves,
+ *    see `VALC_custom_kern`
+ */
+
+struct VALC_cmp {
+  int n_ops;
+  int n_leaves;
+  int or_depth;
+  int or_depth_max;
+  struct VALC_op * ops;  // NULL when just counting
+  SEXP leaves;
+  SEXP deps;
+  struct VALC_settings * set;
+  SEXP memo;
+};
+
+static int VALC_prog_mode(SEXP codes) {
+  if(TYPEOF(codes) == LISTSXP) codes = CAR(codes);
+  if(TYPEOF(codes) != INTSXP || XLENGTH(codes) != 1) {
+    // nocov start
+    error("%s%s",
+      "Internal error: no integer codes produced by parsing process, which ",
+      "should not happen; contact maintainer."
+    );
+    // nocov end
+  }
+  return INTEGER(codes)[0];
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * Look up a function the way `eval` would, but return R_UnboundValue instead
+ * of failing if it cannot be found.
+ */
+SEXP VALC_find_fun(SEXP symb, SEXP rho) {
+  for(; rho != R_EmptyEnv; rho = ENCLOS(rho)) {
+    SEXP val = findVarInFrame(rho, symb);
+    if(val == R_UnboundValue) continue;
+    if(TYPEOF(val) == PROMSXP) val = eval(val, rho);
+    if(isFunction(val)) return val;
+  }
+  return R_UnboundValue;
+}
+/*
+ * Base functions that are known to always produce the same object when
+ * called with the same constant arguments.
+ *
+ * `data.frame` (depends on the `stringsAsFactors` option in R < 4.0.0),
+ * `factor` (level order depends on the collation locale), and `structure`
+ * (which can build factors) are deliberately left out.  Users can still opt
+ * in their own wrappers around them with the "vetr.pure" attribute.
+ */
+static const char * VALC_pure_funs[] = {
+  "c", "list", "logical", "integer", "numeric", "double", "complex",
+  "character", "raw", "vector", "matrix", "array", "rep", "seq_len", "-",
+  ":", "(",
+  NULL
+};
+static int VALC_fun_pure(SEXP symb, SEXP fun) {
+  SEXP pure = getAttrib(fun, VALC_SYM_pure);
+  if(pure != R_NilValue) return IS_TRUE(pure);
+
+  const char * fun_name = CHAR(PRINTNAME(symb));
+  for(const char ** pf = VALC_pure_funs; * pf; ++pf) {
+    if(!strcmp(* pf, fun_name))
+      return fun == findVarInFrame(R_BaseEnv, symb);
+  }
+  return 0;
+}
+/*
+ * Determine whether a template can be evaluated once and re-used.
+ *
+ * This is the case for constants, and for calls to pure functions (see
+ * `VALC_fun_pure`) with constant or pure call arguments.  The functions are
+ * looked up in the vetting environment and recorded in `deps` so the cache
+ * will re-compile if one of them is masked later.
+ */
+static int VALC_tpl_pure(SEXP lang, struct VALC_cmp * cmp) {
+  switch(TYPEOF(lang)) {
+    case NILSXP: case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP:
+    case STRSXP: case RAWSXP:
+      return ATTRIB(lang) == R_NilValue;
+    case LANGSXP: {
+      SEXP fun_symb = CAR(lang);
+      if(TYPEOF(fun_symb) != SYMSXP) return 0;
+      SEXP fun = VALC_find_fun(fun_symb, cmp->set->env);
+      if(fun == R_UnboundValue || !VALC_fun_pure(fun_symb, fun)) return 0;
+
+      for(SEXP args = CDR(lang); args != R_NilValue; args = CDR(args))
+        if(!VALC_tpl_pure(CAR(args), cmp)) return 0;
+      VALC_parse_dep_fun_add(cmp->deps, fun_symb, fun);
+      return 1;
+    }
+    default: return 0;
+  }
+}
+/*
+ * Recognize custom expressions we have C kernels for (see `SCAN_kern`).
+ *
+ * The functions must resolve to the base ones, and as with pure templates we
+ * record them in `deps`.
+ */
+static int VALC_base_fun(SEXP symb, struct VALC_cmp * cmp) {
+  SEXP fun = VALC_find_fun(symb, cmp->set->env);
+  if(fun == R_UnboundValue || fun != findVarInFrame(R_BaseEnv, symb)) return 0;
+  VALC_parse_dep_fun_add(cmp->deps, symb, fun);
+  return 1;
+}
+static int VALC_is_call1(SEXP lang, SEXP symb) {
+  return TYPEOF(lang) == LANGSXP && CAR(lang) == symb &&
+    CDR(lang) != R_NilValue && CDDR(lang) == R_NilValue &&
+    TAG(CDR(lang)) == R_NilValue;
+}
+/*
+ * Numeric scalar constants, possibly negated
+ */
+static int VALC_num_cst(SEXP x, double * c, struct VALC_cmp * cmp) {
+  if(VALC_is_call1(x, VALC_SYM_minus)) {
+    if(!VALC_num_cst(CADR(x), c, cmp) || !VALC_base_fun(VALC_SYM_minus, cmp))
+      return 0;
+    * c = -(* c);
+    return 1;
+  }
+  if(
+    (TYPEOF(x) != INTSXP && TYPEOF(x) != REALSXP) || XLENGTH(x) != 1 ||
+    ATTRIB(x) != R_NilValue
+  )
+    return 0;
+  if(TYPEOF(x) == INTSXP) {
+    if(INTEGER(x)[0] == NA_INTEGER) return 0;
+    * c = INTEGER(x)[0];
+  } else {
+    if(ISNAN(REAL(x)[0])) return 0;
+    * c = REAL(x)[0];
+  }
+  return 1;
+}
+/*
+ * `. op c` or `c op .` for the comparison operators, with `c` a numeric
+ * scalar; returns the kernel with the operands in `. op c` order.
+ */
+static int VALC_cmp_kern(SEXP lang, double * c, struct VALC_cmp * cmp) {
+  if(TYPEOF(lang) != LANGSXP || length(lang) != 3) return SCAN_KERN_NONE;
+  SEXP fun_symb = CAR(lang), lhs = CADR(lang), rhs = CADDR(lang);
+  if(TAG(CDR(lang)) != R_NilValue || TAG(CDDR(lang)) != R_NilValue)
+    return SCAN_KERN_NONE;
+
+  int kern, rev;
+  if(fun_symb == VALC_SYM_gte) {
+    kern = SCAN_KERN_GTE; rev = SCAN_KERN_LTE;
+  } else if(fun_symb == VALC_SYM_lte) {
+    kern = SCAN_KERN_LTE; rev = SCAN_KERN_GTE;
+  } else if(fun_symb == VALC_SYM_gt) {
+    kern = SCAN_KERN_GT; rev = SCAN_KERN_LT;
+  } else if(fun_symb == VALC_SYM_lt) {
+    kern = SCAN_KERN_LT; rev = SCAN_KERN_GT;
+  } else return SCAN_KERN_NONE;
+
+  if(lhs != VALC_SYM_arg) {
+    if(rhs != VALC_SYM_arg) return SCAN_KERN_NONE;
+    kern = rev;
+    rhs = lhs;
+  }
+  if(!VALC_num_cst(rhs, c, cmp) || !VALC_base_fun(fun_symb, cmp))
+    return SCAN_KERN_NONE;
+  return kern;
+}
+static int VALC_custom_kern(SEXP lang, int leaf, struct VALC_cmp * cmp) {
+  double c;
+  int kern = VALC_cmp_kern(lang, &c, cmp);
+  if(kern != SCAN_KERN_NONE) {
+    SET_VECTOR_ELT(cmp->memo, leaf, ScalarReal(c));
+    return kern;
+  }
+  if(
+    VALC_is_call1(lang, VALC_SYM_not) &&
+    VALC_is_call1(CADR(lang), VALC_SYM_isna) &&
+    CADR(CADR(lang)) == VALC_SYM_arg &&
+    VALC_base_fun(VALC_SYM_not, cmp) && VALC_base_fun(VALC_SYM_isna, cmp)
+  )
+    return SCAN_KERN_NO_NA;
+  if(
+    VALC_is_call1(lang, VALC_SYM_isfinite) && CADR(lang) == VALC_SYM_arg &&
+    VALC_base_fun(VALC_SYM_isfinite, cmp)
+  )
+    return SCAN_KERN_FINITE;
+
+  return SCAN_KERN_NONE;
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+static int VALC_compile_emit(
+  struct VALC_cmp * cmp, int code, int leaf, SEXP lang
+) {
+  int i = cmp->n_ops++;
+  if(cmp->ops) {
+    cmp->ops[i].code = code;
+    cmp->ops[i].jump = -1;
+    cmp->ops[i].leaf = leaf;
+    cmp->ops[i].aux = 0;
+    if(leaf >= 0) SET_VECTOR_ELT(cmp->leaves, leaf, lang);
+  }
+  return i;
+}
+/*
+ * Called twice, once with `cmp->ops` NULL to count how much space we need,
+ * and once to actually record the ops.
+ */
+static void VALC_compile_rec(SEXP lang, SEXP codes, struct VALC_cmp * cmp) {
+  int mode = VALC_prog_mode(codes);
+
+  if(mode == 1 || mode == 2) {
+    if(TYPEOF(lang) != LANGSXP || TYPEOF(codes) != LISTSXP) {
+      // nocov start
+      error(
+        "%s%s",
+        "Internal Error: in mode c(1, 2), but not a language object; ",
+        "contact maintainer."
+      );
+      // nocov end
+    }
+    if(length(lang) != 3 || length(codes) != 3) {
+      // nocov start
+      error("%s%s",
+        "Internal Error: unexpected language structure for modes 1/2; ",
+        "contact maintainer."
+      );
+      // nocov end
+    }
+    int jump_from;
+    if(mode == 2) {
+      VALC_compile_emit(cmp, VALC_OP_OR_INIT, -1, R_NilValue);
+      if(++cmp->or_depth > cmp->or_depth_max)
+        cmp->or_depth_max = cmp->or_depth;
+    }
+    VALC_compile_rec(CADR(lang), CADR(codes), cmp);
+    jump_from = VALC_compile_emit(
+      cmp, mode == 1 ? VALC_OP_AND : VALC_OP_OR, -1, R_NilValue
+    );
+    VALC_compile_rec(CADDR(lang), CADDR(codes), cmp);
+    if(mode == 2) {
+      VALC_compile_emit(cmp, VALC_OP_OR_END, -1, R_NilValue);
+      cmp->or_depth--;
+      if(cmp->ops) cmp->ops[jump_from].jump = cmp->n_ops - 1;
+    } else if(cmp->ops) cmp->ops[jump_from].jump = cmp->n_ops;
+  } else if(mode == 10 || mode == 999) {
+    if(
+      (TYPEOF(codes) == LISTSXP) !=
+      (TYPEOF(lang) == LANGSXP || TYPEOF(lang) == LISTSXP)
+    ) {
+      // nocov start
+      error("%s%s",
+        "Internal Error: mismatched language and eval type tracking; contact ",
+        "maintainer."
+      );
+      // nocov end
+    }
+    int i = VALC_compile_emit(
+      cmp, mode == 10 ? VALC_OP_CUSTOM : VALC_OP_TEMPLATE, cmp->n_leaves++,
+      lang
+    );
+    // Only calls are worth memoizing, constants evaluate to themselves
+
+    if(
+      cmp->ops && mode == 999 && TYPEOF(lang) == LANGSXP &&
+      VALC_tpl_pure(lang, cmp)
+    )
+      cmp->ops[i].aux = VALC_OP_AUX_PURE;
+    else if(cmp->ops && mode == 10)
+      cmp->ops[i].aux = VALC_custom_kern(lang, cmp->ops[i].leaf, cmp);
+  } else {
+    error("Internal Error: unexpected parse mode %d", mode);  // nocov
+  }
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * @param lang the uncompiled vetting expression, only recorded for reference
+ * @param parsed the return value of `VALC_parse`
+ * @param set the settings, used to resolve template functions
+ * @param deps where to record function lookups, see `VALC_parse_dep_add`
+ */
+SEXP VALC_compile_parsed(
+  SEXP lang, SEXP parsed, struct VALC_settings set, SEXP deps
+) {
+  SEXP lang_parsed = VECTOR_ELT(parsed, 0), codes = VECTOR_ELT(parsed, 1);
+  struct VALC_cmp cmp = {
+    0, 0, 0, 0, NULL, R_NilValue, deps, &set, R_NilValue
+  };
+
+  VALC_compile_rec(lang_parsed, codes, &cmp);
+
+  int n_ops = cmp.n_ops, n_leaves = cmp.n_leaves;
+  size_t prog_size = sizeof(struct VALC_prog) + n_ops * sizeof(struct VALC_op);
+  if(prog_size % sizeof(int)) error("Internal Error: bad op size.");  // nocov
+
+  SEXP prog_dat = PROTECT(allocVector(VECSXP, 5));
+  SEXP ops_sxp = PROTECT(allocVector(INTSXP, prog_size / sizeof(int)));
+  SET_VECTOR_ELT(prog_dat, 0, lang);
+  SET_VECTOR_ELT(prog_dat, 1, lang_parsed);
+  SET_VECTOR_ELT(prog_dat, 2, allocVector(VECSXP, n_leaves));
+  SET_VECTOR_ELT(prog_dat, 3, ops_sxp);
+  SET_VECTOR_ELT(prog_dat, 4, allocVector(VECSXP, n_leaves));
+
+  struct VALC_prog * prog = (struct VALC_prog *) INTEGER(ops_sxp);
+  cmp = (struct VALC_cmp) {
+    0, 0, 0, 0, prog->ops, VECTOR_ELT(prog_dat, 2), deps, &set,
+    VECTOR_ELT(prog_dat, 4)
+  };
+  VALC_compile_rec(lang_parsed, codes, &cmp);
+
+  prog->n_ops = n_ops;
+  prog->n_leaves = n_leaves;
+  prog->or_depth = cmp.or_depth_max;
+  prog->flags = 0;
+
+  SEXP res = R_MakeExternalPtr(prog, VALC_SYM_prog, prog_dat);
+  UNPROTECT(2);
+  return res;
+}
+/*
+ * Parse and compile
+ */
+SEXP VALC_compile(SEXP lang, struct VALC_settings set, SEXP deps) {
+  SEXP parsed = PROTECT(VALC_parse(lang, VALC_SYM_arg, set, deps));
+  SEXP res = VALC_compile_parsed(lang, parsed, set, deps);
+  UNPROTECT(1);
+  return res;
+}
+SEXP VALC_compile_ext(SEXP lang, SEXP rho, SEXP settings) {
+  struct VALC_settings set = VALC_settings_vet(settings, rho);
+  return VALC_compile(lang, set, R_NilValue);
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+
+int VALC_is_prog(SEXP x) {
+  return TYPEOF(x) == EXTPTRSXP && R_ExternalPtrTag(x) == VALC_SYM_prog;
+}
+/*
+ * Retrieve the program from the external pointer.  Serialized external
+ * pointers come back with a NULL address, but since the program data is in
+ * the protected value we can just point back to it.
+ */
+struct VALC_prog * VALC_prog_get(SEXP prog_sxp) {
+  if(!VALC_is_prog(prog_sxp))
+    error("Internal Error: not a vetr program; contact maintainer.");  // nocov
+
+  struct VALC_prog * prog = R_ExternalPtrAddr(prog_sxp);
+  if(!prog) {
+    SEXP prog_dat = R_ExternalPtrProtected(prog_sxp);
+    if(
+      TYPEOF(prog_dat) != VECSXP || XLENGTH(prog_dat) != 5 ||
+      TYPEOF(VECTOR_ELT(prog_dat, 3)) != INTSXP
+    )
+      error("Corrupted vetr program.");
+    prog = (struct VALC_prog *) INTEGER(VECTOR_ELT(prog_dat, 3));
+    R_SetExternalPtrAddr(prog_sxp, prog);
+  }
+  return prog;
+}
+SEXP VALC_prog_leaves(SEXP prog_sxp) {
+  return VECTOR_ELT(R_ExternalPtrProtected(prog_sxp), 2);
+}
+SEXP VALC_prog_memo(SEXP prog_sxp) {
+  return VECTOR_ELT(R_ExternalPtrProtected(prog_sxp), 4);
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * Substitute the current argument expression for the `.` placeholder.
+ *
+ * Custom expressions are evaluated with the placeholder bound to the value
+ * being vetted (see `VALC_run`), so this is only needed to show the
+ * expression as the user wrote it in error messages.  The parse only ever puts
+ * the placeholder in argument positions of calls so we only need to recurse
+ * through calls.
+ */
+static void VALC_sub_arg_rec(SEXP lang, SEXP arg_lang) {
+  for(; lang != R_NilValue; lang = CDR(lang)) {
+    SEXP lang_car = CAR(lang);
+    if(lang_car == VALC_SYM_arg) SETCAR(lang, arg_lang);
+    else if(TYPEOF(lang_car) == LANGSXP) VALC_sub_arg_rec(lang_car, arg_lang);
+  }
+}
+SEXP VALC_sub_arg(SEXP lang, SEXP arg_lang) {
+  if(lang == VALC_SYM_arg) return arg_lang;
+  if(TYPEOF(lang) != LANGSXP) return lang;
+
+  SEXP res = PROTECT(duplicate(lang));
+  VALC_sub_arg_rec(res, arg_lang);
+  UNPROTECT(1);
+  return res;
+}
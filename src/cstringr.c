@@ -264,6 +264,64 @@ char * CSR_smprintf1(size_t maxlen, const char * format, const char * a) {
   return(CSR_smprintf6(maxlen, format, a, "", "", "", "", ""));
 }
 
+// - String Builder ------------------------------------------------------------
+
+/*
+ * Growable string builder
+ *
+ * Appending to a string with `CSR_smprintf*` copies the whole string each time
+ * so building a string out of many pieces is quadratic.  The builder instead
+ * keeps a buffer that at least doubles in size when it runs out of room so
+ * that appending is amortized linear.
+ *
+ * Buffers are `R_alloc`ed so they live in the `.Call` transient memory arena
+ * and are released along with everything else when the `.Call` returns.
+ * Outgrown buffers are not released until then, but since sizes double they
+ * add up to less than the final buffer.  `CSR_strbuf_reset` empties the
+ * builder but keeps its buffer so it can be re-used for the next string.
+ *
+ * The string is limited to `maxlen` characters; appending past that truncates
+ * with a warning like `CSR_strmcpy` does.
+ */
+struct CSR_strbuf CSR_strbuf_init(size_t size, size_t maxlen) {
+  if(size < 16) size = 16;
+  struct CSR_strbuf buf = {
+    .buff = R_alloc(size, sizeof(char)), .len = 0, .size = size,
+    .maxlen = maxlen, .truncated = 0
+  };
+  buf.buff[0] = '\0';
+  return buf;
+}
+void CSR_strbuf_add(struct CSR_strbuf * buf, const char * str) {
+  size_t room = buf->maxlen - buf->len;
+  size_t len = CSR_strmlen_x(str, room);
+
+  if(len == room && str[len]) {
+    if(!buf->truncated)
+      warning("CSR_strbuf_add: truncated string longer than %zu", buf->maxlen);
+    buf->truncated = 1;
+  }
+  if(!len) return;
+
+  size_t need = CSR_add_szt(buf->len, len + 1);
+  if(need > buf->size) {
+    size_t size_new = CSR_add_szt(buf->size, buf->size);
+    if(size_new < need) size_new = need;
+    char * buff_new = R_alloc(size_new, sizeof(char));
+    memcpy(buff_new, buf->buff, buf->len);
+    buf->buff = buff_new;
+    buf->size = size_new;
+  }
+  memcpy(buf->buff + buf->len, str, len);
+  buf->len += len;
+  buf->buff[buf->len] = '\0';
+}
+void CSR_strbuf_reset(struct CSR_strbuf * buf) {
+  buf->len = 0;
+  buf->truncated = 0;
+  buf->buff[0] = '\0';
+}
+
 // - Capitalization functions --------------------------------------------------
 
 /* Make copy and capitalize first letter */
@@ -27,6 +27,16 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 
 #define CSR_MAX_CHAR 50000
 
+  // String builder, see `CSR_strbuf_init`
+
+  struct CSR_strbuf {
+    char * buff;
+    size_t len;       // excluding the NULL terminator
+    size_t size;      // allocated size, including the NULL terminator
+    size_t maxlen;
+    int truncated;    // whether we already warned about truncation
+  };
+
   // Testing Functions
 
   SEXP CSR_len_chr_len_ext(SEXP a);
@@ -47,6 +57,7 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
   SEXP CSR_test_strappend2();
   SEXP CSR_test_add_szt();
   SEXP CSR_test_smprintfx();
+  SEXP CSR_test_strbuf();
 
   // Internal Functions
 
@@ -87,4 +98,8 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 
   size_t CSR_add_szt(size_t a, size_t b);
 
+  struct CSR_strbuf CSR_strbuf_init(size_t size, size_t maxlen);
+  void CSR_strbuf_add(struct CSR_strbuf * buf, const char * str);
+  void CSR_strbuf_reset(struct CSR_strbuf * buf);
+
 #endif
@@ -67,3 +67,28 @@ SEXP CSR_test_strappend2() {
   CSR_strappend(str_new, "hellothere", 5);
   return R_NilValue;
 }
+/*
+ * Exercise the string builder: growth past the initial size, reset, and
+ * truncation at `maxlen` (which should warn)
+ */
+SEXP CSR_test_strbuf() {
+  SEXP res = PROTECT(allocVector(STRSXP, 3));
+  struct CSR_strbuf buf = CSR_strbuf_init(0, 10000);
+  int i;
+
+  for(i = 0; i < 200; ++i) CSR_strbuf_add(&buf, i % 2 ? "b" : "a");
+  SET_STRING_ELT(res, 0, mkChar(buf.buff));
+  CSR_strbuf_reset(&buf);
+  CSR_strbuf_add(&buf, "hello");
+  CSR_strbuf_add(&buf, " ");
+  CSR_strbuf_add(&buf, "world");
+  SET_STRING_ELT(res, 1, mkChar(buf.buff));
+
+  struct CSR_strbuf buf2 = CSR_strbuf_init(4, 8);
+  CSR_strbuf_add(&buf2, "hello");
+  CSR_strbuf_add(&buf2, " world");
+  CSR_strbuf_add(&buf2, " again");
+  SET_STRING_ELT(res, 2, mkChar(buf2.buff));
+  UNPROTECT(1);
+  return res;
+}
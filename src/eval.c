@@ -21,331 +21,543 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 /* -------------------------------------------------------------------------- *\
 \* -------------------------------------------------------------------------- */
 /*
- * @param arg_lang the substituted language corresponding to the argument
- * @param arg_tag the argument name
+ * Copy `n` elements of atomic vector `x` starting at `i` into a new vector,
+ * without materializing ALTREP vectors where we can avoid it.
  */
-
-SEXP VALC_evaluate_recurse(
-  SEXP lang, SEXP act_codes, SEXP arg_value, SEXP arg_lang, SEXP arg_tag,
-  SEXP lang_full, struct VALC_settings set
-) {
-  /*
-  check act_codes:
-    if 1 or 2
-      recurse and:
-        if return value is TRUE
-          and act_code == 2, return TRUE
-          and act_code == 1, continue
-        if return value is character
-          and act_code == 1,
-            return
-          and act_code == 2,
-            record for later return if no TRUEs are met
-        if return value is TRUE,
-        if with mode set to corresponding value (does it matter)
-    if 10, eval as is
-      if returns character then return character
-      if returns FALSE deparse into something like (`x` does not eval to TRUE`)
-    if 999, eval as alike
-  */
-  int mode;
-
-  if(TYPEOF(act_codes) == LISTSXP) {
-    if(TYPEOF(lang) != LANGSXP && TYPEOF(lang) != LISTSXP) {
+static SEXP VALC_slice(SEXP x, R_xlen_t i, R_xlen_t n) {
+  SEXP res = PROTECT(allocVector(TYPEOF(x), n));
+  switch(TYPEOF(x)) {
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 5, 0)
+    case LGLSXP: LOGICAL_GET_REGION(x, i, n, LOGICAL(res)); break;
+    case INTSXP: INTEGER_GET_REGION(x, i, n, INTEGER(res)); break;
+    case REALSXP: REAL_GET_REGION(x, i, n, REAL(res)); break;
+#else
+    case LGLSXP:
+      memcpy(LOGICAL(res), LOGICAL(x) + i, n * sizeof(int)); break;
+    case INTSXP:
+      memcpy(INTEGER(res), INTEGER(x) + i, n * sizeof(int)); break;
+    case REALSXP:
+      memcpy(REAL(res), REAL(x) + i, n * sizeof(double)); break;
+#endif
+    case CPLXSXP:
+      memcpy(COMPLEX(res), COMPLEX(x) + i, n * sizeof(Rcomplex)); break;
+    case RAWSXP:
+      memcpy(RAW(res), RAW(x) + i, n * sizeof(Rbyte)); break;
+    case STRSXP:
+      for(R_xlen_t j = 0; j < n; ++j)
+        SET_STRING_ELT(res, j, STRING_ELT(x, i + j));
+      break;
+    default:
       // nocov start
-      error("%s%s"
-        "Internal Error: mismatched language and eval type tracking 1; contact ",
-        "maintainer."
+      error(
+        "Internal Error: cannot slice type %s; contact maintainer.",
+        type2char(TYPEOF(x))
       );
       // nocov end
+  }
+  UNPROTECT(1);
+  return res;
+}
+/*
+ * Evaluate a custom expression flagged as element-wise (see `vet_token`) on
+ * `set.chunk_len` sized slices of `arg_value` so we never hold more than a
+ * slice worth of temporaries, stopping at the first slice that fails.
+ *
+ * Only plain atomic vectors are sliced.  The outcome recorded in `leaf_res` is
+ * the one `VALC_all` would produce on the result for the whole object.
+ *
+ * @return 1 if the expression was evaluated, 0 if it must be evaluated on the
+ *   whole object instead
+ */
+static int VALC_eval_chunked(
+  SEXP lang, SEXP rho_dot, SEXP arg_value, struct VALC_leaf_res * leaf_res,
+  SEXP arg_tag, SEXP lang_full, struct VALC_settings set
+) {
+  if(
+    set.chunk_len < 1 || !isVectorAtomic(arg_value) || OBJECT(arg_value) ||
+    XLENGTH(arg_value) <= set.chunk_len
+  )
+    return 0;
+  SEXP ew = getAttrib(lang, VALC_SYM_elementwise);
+  if(TYPEOF(ew) != LGLSXP || XLENGTH(ew) != 1 || LOGICAL(ew)[0] != 1)
+    return 0;
+
+  R_xlen_t len = XLENGTH(arg_value);
+  int code = 1, type = LGLSXP, err_val = 0;
+
+  for(R_xlen_t i = 0; i < len && code > 0; i += set.chunk_len) {
+    R_xlen_t n = len - i > set.chunk_len ? set.chunk_len : len - i;
+    defineVar(VALC_SYM_arg, VALC_slice(arg_value, i, n), rho_dot);
+    SEXP res = PROTECT(R_tryEval(lang, rho_dot, &err_val));
+    if(err_val) {
+      VALC_arg_error(
+        arg_tag, lang_full,
+        "Validation expression for argument `%s` produced an error (see previous error)."
+      );
     }
-    if(TYPEOF(CAR(act_codes)) != INTSXP) {
-      // nocov start
-      error("%s%s",
-        "Internal error: no integer codes produced by parsing process, which ",
-        "should not happen; contact maintainer."
+    type = TYPEOF(res);
+    if(type == LGLSXP && XLENGTH(res) != n) {
+      VALC_arg_error(
+        arg_tag, lang_full,
+        "Element-wise validation expression for argument `%s` did not produce one value per element."
       );
-      // nocov end
-    } else {
-      mode=asInteger(CAR(act_codes));
     }
+    // `len` is greater than one so only the multi-element codes apply
+
+    switch(VALC_all(res)) {
+      case -2: code = -2; break;
+      case -3: case -4: code = -4; break;
+      case -1: case 0: code = 0; break;
+    }
+    UNPROTECT(1);
+  }
+  defineVar(VALC_SYM_arg, arg_value, rho_dot);
+  * leaf_res = (struct VALC_leaf_res) {1, code, type};
+  return 1;
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * Evaluate a single leaf of a compiled program
+ *
+ * @param lang the leaf expression, with `.` substituted by `VALC_SYM_arg`
+ * @param code either VALC_OP_CUSTOM or VALC_OP_TEMPLATE
+ * @param memo for pure templates (see `VALC_tpl_pure`) the VECSXP with the
+ *   memoized template values, R_NilValue otherwise
+ * @param leaf the index of the leaf in `memo`
+ * @param rho_dot for custom expressions, the environment with `VALC_SYM_arg`
+ *   bound to `arg_value`, see `VALC_dot_env`
+ * @param leaf_res the recorded outcome of the leaf; custom expressions are
+ *   only evaluated if they have not been already, and templates that passed
+ *   are not checked again
+ * @param tpl_vals for templates that are not pure, the VECSXP that records
+ *   their values so the message pass can re-use them, see `VALC_leaf_vals`
+ * @param arg_lang the substituted language corresponding to the argument
+ * @param arg_tag the argument name
+ * @param err set to a character vector describing the failure if the leaf
+ *   failed and `set.no_msg` is not set, length one for custom expressions and
+ *   length five for templates (see `ALIKEC_strsxp_or_true`); must be
+ *   PROTECTed by the caller
+ * @return 1 if the leaf passed, 0 otherwise
+ */
+static int VALC_eval_leaf(
+  SEXP lang, int code, SEXP memo, int leaf, SEXP rho_dot,
+  struct VALC_leaf_res * leaf_res, SEXP tpl_vals, SEXP arg_value,
+  SEXP arg_lang, SEXP arg_tag, SEXP lang_full, struct VALC_settings set,
+  SEXP * err
+) {
+  SEXP eval_res, eval_tmp = R_NilValue;
+  int err_val = 0;
+  int eval_res_c = -1000;  // initialize to illegal value
+  int * err_point = &err_val;
+
+  * err = R_NilValue;
+
+  if(code == VALC_OP_CUSTOM) {
+    if(
+      !leaf_res->done && !VALC_eval_chunked(
+        lang, rho_dot, arg_value, leaf_res, arg_tag, lang_full, set
+      )
+    ) {
+      eval_tmp = PROTECT(R_tryEval(lang, rho_dot, err_point));
+      if(* err_point) {
+        VALC_arg_error(
+          arg_tag, lang_full,
+          "Validation expression for argument `%s` produced an error (see previous error)."
+        );
+      }
+      leaf_res->code = VALC_all(eval_tmp);
+      leaf_res->type = TYPEOF(eval_tmp);
+      leaf_res->done = 1;
+      UNPROTECT(1);
+    }
+    eval_res_c = leaf_res->code;
+    if(eval_res_c > 0) return 1;
+    if(set.no_msg) return 0;
   } else {
-    if(TYPEOF(lang) == LANGSXP || TYPEOF(lang) == LISTSXP) {
+    if(leaf_res->done && leaf_res->code) return 1;
+
+    // A NULL memoized value just means we have not evaluated the template yet,
+    // or that it evaluates to NULL in which case it is cheap to do again.
+    // Values of other templates are only kept for the length of the run.
+
+    int have_val = 0;
+    if(memo != R_NilValue) {
+      eval_tmp = VECTOR_ELT(memo, leaf);
+      have_val = eval_tmp != R_NilValue;
+    } else if(leaf_res->done && tpl_vals != R_NilValue) {
+      eval_tmp = VECTOR_ELT(tpl_vals, leaf);
+      have_val = 1;
+    }
+    if(!have_val) {
+      eval_tmp = R_tryEval(lang, set.env, err_point);
+      if(* err_point) {
+        VALC_arg_error(
+          arg_tag, lang_full,
+          "Validation expression for argument `%s` produced an error (see previous error)."
+        );
+      }
+      if(memo != R_NilValue) {
+        VALC_not_mutable(eval_tmp);
+        SET_VECTOR_ELT(memo, leaf, eval_tmp);
+      } else if(tpl_vals != R_NilValue) {
+        SET_VECTOR_ELT(tpl_vals, leaf, eval_tmp);
+      }
+    }
+    PROTECT(eval_tmp);
+    if(set.no_msg) {
+      int success = ALIKEC_alike_internal(eval_tmp, arg_value, set).success;
+      * leaf_res = (struct VALC_leaf_res) {1, success, TYPEOF(eval_tmp)};
+      UNPROTECT(1);
+      return success;
+    }
+    eval_res = ALIKEC_alike_int2(eval_tmp, arg_value, arg_lang, set);
+    UNPROTECT(1);
+    if(TYPEOF(eval_res) == LGLSXP && asLogical(eval_res) == 1) return 1;
+
+    // Sanity checks
+
+    if(TYPEOF(eval_res) != STRSXP || XLENGTH(eval_res) != 5) {
       // nocov start
-      error("%s%s",
-        "Internal Error: mismatched language and eval type tracking 2; contact ",
-        "maintainer."
+      error("%s (is type: %s), %s",
+        "Internal Error: template eval must be TRUE or character(5L)",
+        type2char(TYPEOF(eval_res)), "contact maintainer."
       );
       // nocov end
     }
-    mode = asInteger(act_codes);
+    * err = eval_res;
+    return 0;
   }
-  if(mode == 1 || mode == 2) {
-    // Dealing with && or ||, so recurse on each element
-
-    if(TYPEOF(lang) == LANGSXP) {
-      int parse_count = 0;
-      SEXP err_list = PROTECT(allocList(0)); // Track errors
-      SEXP eval_res;
-      lang = CDR(lang);
-      act_codes = CDR(act_codes);
-
-      while(lang != R_NilValue) {
-        eval_res = PROTECT(
-          VALC_evaluate_recurse(
-            CAR(lang), CAR(act_codes), arg_value, arg_lang, arg_tag, lang_full,
-            set
-        ) );
-        if(TYPEOF(eval_res) == LISTSXP) {
-          if(mode == 1) {
-            // At least one non-TRUE result, which is a failure, so return
-            UNPROTECT(2);
-            return(eval_res);
-          }
-          if(mode == 2)  {// All need to fail, so store errors for now
-            err_list = listAppend(err_list, eval_res);
-          }
-        } else if (VALC_all(eval_res) > 0) {
-          if(mode == 2) {
-            UNPROTECT(2);
-            return(ScalarLogical(1)); // At least one TRUE value in or mode
-          }
-        } else {
+  // User eval, special treatment to produce err msg.
+
+  SEXP err_msg, err_attrib;
+  const char * err_call;
+
+  // If message attribute defined, this is easy:
+
+  if((err_attrib = getAttrib(lang, VALC_SYM_errmsg)) != R_NilValue) {
+    if(TYPEOF(err_attrib) != STRSXP || XLENGTH(err_attrib) != 1) {
+      VALC_arg_error(
+        arg_tag, lang_full,
+        "\"err.msg\" attribute for validation token for argument `%s` must be a one length character vector."
+      );
+    }
+    err_call = ALIKEC_pad_or_quote(arg_lang, set.width, -1, set);
+
+    // Need to make copy of string, modify it, and turn it back into
+    // string
+
+    const char * err_attrib_msg = CHAR(STRING_ELT(err_attrib, 0));
+    char * err_attrib_mod = CSR_smprintf4(
+      set.nchar_max, err_attrib_msg, err_call, "", "", ""
+    );
+    err_msg = mkString(err_attrib_mod);
+  } else {
+    // message attribute not defined, must construct error message based
+    // on result of evaluation; we show the expression as the user would have
+    // written it so need to put the argument expression back in place of `.`
+
+    SEXP lang_show = PROTECT(VALC_sub_arg(lang, arg_lang));
+    err_call = ALIKEC_pad_or_quote(lang_show, set.width, -1, set);
+    UNPROTECT(1);
+
+    char * err_str;
+    char * err_tok;
+    switch(eval_res_c) {
+      case -2: {
+        const char * err_tok_tmp = type2char(leaf_res->type);
+        const char * err_tok_base = "is \"%s\" instead of a \"logical\"";
+        err_tok = R_alloc(
+          strlen(err_tok_tmp) + strlen(err_tok_base), sizeof(char)
+        );
+        if(sprintf(err_tok, err_tok_base, err_tok_tmp) < 0)
           // nocov start
-          error("%s%s",
-            "Internal Error: unexpected return value when recursively ",
-            "evaluating parse; contact maintainer."
+          error(
+            "Internal error: build token error failure; contact maintainer"
           );
           // nocov end
         }
-        lang = CDR(lang);
-        act_codes = CDR(act_codes);
-        parse_count++;
-        UNPROTECT(1);
-      }
-      if(parse_count != 2) {
+        break;
+      case -1: err_tok = "FALSE"; break;
+      case -3: err_tok = "NA"; break;
+      case -4: err_tok = "contains NAs"; break;
+      case -5: err_tok = "zero length"; break;
+      case 0: err_tok = "contains non-TRUE values"; break;
+      default: {
         // nocov start
-        error("%s%s",
-          "Internal Error: unexpected language structure for modes 1/2; ",
-          "contact maintainer."
+        error(
+          "Internal Error: %s %d; contact maintainer.",
+          "unexpected user exp eval value", eval_res_c
         );
         // nocov end
       }
-      UNPROTECT(1);
-      // Only way to get here is if none of previous actually returned TRUE and
-      // mode is OR
-      if(mode == 2) {
-        return(err_list);
-      }
-      return(eval_res);  // Or if all returned TRUE and mode is AND
+    }
+    const char * err_extra_a = "is not all TRUE";
+    const char * err_extra_b = "is not TRUE"; // must be shorter than _a
+    const char * err_extra;
+    if(eval_res_c == 0) {
+      err_extra = err_extra_a;
     } else {
+      err_extra = err_extra_b;
+    }
+    const char * err_base = "%s%s (%s)";
+    err_str = R_alloc(
+      strlen(err_call) + strlen(err_base) + strlen(err_tok) +
+      strlen(err_extra), sizeof(char)
+    );
+    // not sure why we're not using cstringr here
+    if(sprintf(err_str, err_base, err_call, err_extra, err_tok) < 0) {
       // nocov start
       error(
-        "%s%s",
-        "Internal Error: in mode c(1, 2), but not a language object; ",
+        "%s%s", "Internal Error: could not construct error message; ",
         "contact maintainer."
       );
       // nocov end
     }
-  } else if(mode == 10 || mode == 999) {
-    SEXP eval_res, eval_tmp;
-    int err_val = 0;
-    int eval_res_c = -1000;  // initialize to illegal value
-    int * err_point = &err_val;
-    eval_tmp = PROTECT(R_tryEval(lang, set.env, err_point));
-    if(* err_point) {
-      VALC_arg_error(
-        arg_tag, lang_full,
-        "Validation expression for argument `%s` produced an error (see previous error)."
-      );
-    }
-    if(mode == 10) {
-      eval_res_c = VALC_all(eval_tmp);
-      eval_res = PROTECT(ScalarLogical(eval_res_c > 0));
-    } else {
-      eval_res = PROTECT(ALIKEC_alike_int2(eval_tmp, arg_value, arg_lang, set));
-    }
-    // Sanity checks
+    err_msg = mkString(err_str);
+  }
+  * err = err_msg;
+  return 0;
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * Create the environment custom expressions are evaluated in.
+ *
+ * This is a child of the evaluation environment with the `.` placeholder bound
+ * to the value being vetted so that we do not need to re-evaluate the
+ * argument expression for every custom token.
+ */
+static SEXP VALC_dot_env(SEXP arg_value, struct VALC_settings set) {
+#if defined(R_VERSION) && R_VERSION >= R_Version(4, 1, 0)
+  SEXP rho_dot = PROTECT(R_NewEnv(set.env, FALSE, 0));
+#else
+  SEXP rho_dot = PROTECT(NewEnvironment(R_NilValue, R_NilValue, set.env));
+#endif
+  defineVar(VALC_SYM_arg, arg_value, rho_dot);
+  UNPROTECT(1);
+  return rho_dot;
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * Run the kernel for the custom leaf at `ip`, see `SCAN_kern`
+ *
+ * If it is followed by more kernel leaves joined with `&&`, as in the
+ * predefined tokens (e.g. `NO.NA && NO.INF && GTE.0`), we run them all in one
+ * pass over the data with `SCAN_kern_chain`.  Kernels record their outcomes
+ * directly in `leaf_res` so `VALC_eval_leaf` does not evaluate them in R.
+ */
+static double VALC_kern_c(struct VALC_op op, SEXP memo) {
+  return op.aux >= SCAN_KERN_GTE ? REAL(VECTOR_ELT(memo, op.leaf))[0] : 0;
+}
+static void VALC_run_kern(
+  struct VALC_prog * prog, int ip, SEXP memo,
+  struct VALC_leaf_res * leaf_res, SEXP arg_value, struct VALC_settings set
+) {
+  int kerns[VALC_KERN_CHAIN], leaves[VALC_KERN_CHAIN], codes[VALC_KERN_CHAIN];
+  double cs[VALC_KERN_CHAIN];
+  int n = 0;
 
-    int is_tf = TYPEOF(eval_res) == LGLSXP && XLENGTH(eval_res) == 1L &&
-      asInteger(eval_res) != NA_INTEGER;
-    int is_val_string = TYPEOF(eval_res) == STRSXP &&
-      (XLENGTH(eval_res) == 5 || XLENGTH(eval_res) == 1);
+  for(
+    int i = ip;
+    i < prog->n_ops && n < VALC_KERN_CHAIN &&
+    prog->ops[i].code == VALC_OP_CUSTOM &&
+    prog->ops[i].aux != SCAN_KERN_NONE && !leaf_res[prog->ops[i].leaf].done;
+    i += 2
+  ) {
+    kerns[n] = prog->ops[i].aux;
+    leaves[n] = prog->ops[i].leaf;
+    cs[n] = VALC_kern_c(prog->ops[i], memo);
+    ++n;
+    if(i + 1 >= prog->n_ops || prog->ops[i + 1].code != VALC_OP_AND) break;
+  }
+  int n_done = 0;
+  if(n > 1)
+    n_done =
+      SCAN_kern_chain(kerns, cs, n, arg_value, set.par_min_len, codes);
+  if(!n_done) {
+    codes[0] = SCAN_kern(kerns[0], arg_value, cs[0], set.par_min_len);
+    n_done = codes[0] != SCAN_KERN_NA;
+  }
+  for(int k = 0; k < n_done; ++k)
+    leaf_res[leaves[k]] = (struct VALC_leaf_res) {1, codes[k], LGLSXP};
+}
+/* -------------------------------------------------------------------------- *\
+\* -------------------------------------------------------------------------- */
+/*
+ * Run a compiled program, see compile.c
+ *
+ * A failing leaf pushes its error message on a stack; `&&` stops on the first
+ * failure, and `||` discards the errors from its branches if one of them
+ * passes.  Since there can't be more errors on the stack than there are
+ * leaves we can size the stack up front (but only do so once we actually have
+ * an error).  With `set.no_msg` we only track whether the program passes.
+ *
+ * @param prog_sxp a compiled program, must be PROTECTed by caller
+ * @param leaf_res outcomes of the leaves, one per leaf, see `VALC_eval_leaf`
+ * @param tpl_vals values of the templates, see `VALC_leaf_vals`
+ * @return TRUE, or a pairlist of character vectors describing the failures,
+ *   or FALSE if `set.no_msg` is set
+ */
+SEXP VALC_run(
+  SEXP prog_sxp, struct VALC_leaf_res * leaf_res, SEXP tpl_vals,
+  SEXP arg_value, SEXP arg_lang, SEXP arg_tag, SEXP lang_full,
+  struct VALC_settings set
+) {
+  struct VALC_prog * prog = VALC_prog_get(prog_sxp);
+  SEXP leaves = VALC_prog_leaves(prog_sxp);
+  SEXP memo = VALC_prog_memo(prog_sxp);
 
-    if(!(is_tf || is_val_string)) {
-      // nocov start
-      error("%s %s (is type: %s), %s",
-        "Internal Error: token eval must be TRUE, FALSE, character(1L), ",
-        " or character(5L)", type2char(TYPEOF(eval_res)), "contact maintainer."
-      );
-      // nocov end
-    }
-    // Note we're handling both user exp and template eval here
+  int or_chk_stack[VALC_OR_DEPTH_STACK];
+  int * or_chk = or_chk_stack;
+  if(prog->or_depth > VALC_OR_DEPTH_STACK)
+    or_chk = (int *) R_alloc(prog->or_depth, sizeof(int));
 
-    if(
-      TYPEOF(eval_res) != LGLSXP || !asLogical(eval_res)
-    ) {
-      SEXP err_msg = PROTECT(allocList(1));
-      // mode == 10 is user eval, special treatment to produce err msg
-
-      if(mode == 10) {
-        // Tried to do this as part of init originally so we don't have to repeat
-        // wholesale creation of call, but the call elements kept getting over
-        // written by other stuff.  Not sure how to protect in calls defined at
-        // top level
-
-        SEXP err_attrib;
-        const char * err_call;
-
-        // If message attribute defined, this is easy:
-
-        if((err_attrib = getAttrib(lang, VALC_SYM_errmsg)) != R_NilValue) {
-          if(TYPEOF(err_attrib) != STRSXP || XLENGTH(err_attrib) != 1) {
-            VALC_arg_error(
-              arg_tag, lang_full,
-              "\"err.msg\" attribute for validation token for argument `%s` must be a one length character vector."
-            );
-          }
-          err_call = ALIKEC_pad_or_quote(arg_lang, set.width, -1, set);
-
-          // Need to make copy of string, modify it, and turn it back into
-          // string
-
-          const char * err_attrib_msg = CHAR(STRING_ELT(err_attrib, 0));
-          char * err_attrib_mod = CSR_smprintf4(
-            set.nchar_max, err_attrib_msg, err_call, "", "", ""
-          );
-          // not protecting mkString since assigning to protected object
-          SETCAR(err_msg, mkString(err_attrib_mod));
-        } else {
-          // message attribute not defined, must construct error message based
-          // on result of evaluation
-
-          err_call = ALIKEC_pad_or_quote(lang, set.width, -1, set);
-
-          char * err_str;
-          char * err_tok;
-          switch(eval_res_c) {
-            case -2: {
-              const char * err_tok_tmp = type2char(TYPEOF(eval_tmp));
-              const char * err_tok_base = "is \"%s\" instead of a \"logical\"";
-              err_tok = R_alloc(
-                strlen(err_tok_tmp) + strlen(err_tok_base), sizeof(char)
-              );
-              if(sprintf(err_tok, err_tok_base, err_tok_tmp) < 0)
-                // nocov start
-                error(
-                  "Internal error: build token error failure; contact maintainer"
-                );
-                // nocov end
-              }
-              break;
-            case -1: err_tok = "FALSE"; break;
-            case -3: err_tok = "NA"; break;
-            case -4: err_tok = "contains NAs"; break;
-            case -5: err_tok = "zero length"; break;
-            case 0: err_tok = "contains non-TRUE values"; break;
-            default: {
-              // nocov start
-              error(
-                "Internal Error: %s %d; contact maintainer.",
-                "unexpected user exp eval value", eval_res_c
-              );
-              // nocov end
-            }
-          }
-          const char * err_extra_a = "is not all TRUE";
-          const char * err_extra_b = "is not TRUE"; // must be shorter than _a
-          const char * err_extra;
-          if(eval_res_c == 0) {
-            err_extra = err_extra_a;
-          } else {
-            err_extra = err_extra_b;
-          }
-          const char * err_base = "%s%s (%s)";
-          err_str = R_alloc(
-            strlen(err_call) + strlen(err_base) + strlen(err_tok) +
-            strlen(err_extra), sizeof(char)
-          );
-          // not sure why we're not using cstringr here
-          if(sprintf(err_str, err_base, err_call, err_extra, err_tok) < 0) {
-            // nocov start
-            error(
-              "%s%s", "Internal Error: could not construct error message; ",
-              "contact maintainer."
-            );
-            // nocov end
-          }
-          SETCAR(err_msg, mkString(err_str));
+  int ip = 0, pass = 1, err_n = 0, or_n = 0;
+  SEXP errs = R_NilValue, rho_dot = R_NilValue;
+  PROTECT_INDEX ipx, ipx_dot;
+  PROTECT_WITH_INDEX(errs, &ipx);
+  PROTECT_WITH_INDEX(rho_dot, &ipx_dot);
+
+  while(ip < prog->n_ops) {
+    struct VALC_op op = prog->ops[ip];
+    switch(op.code) {
+      case VALC_OP_TEMPLATE:
+      case VALC_OP_CUSTOM: {
+        if(op.code == VALC_OP_CUSTOM) {
+          struct VALC_leaf_res * res = leaf_res + op.leaf;
+          if(!res->done && op.aux != SCAN_KERN_NONE)
+            VALC_run_kern(prog, ip, memo, leaf_res, arg_value, set);
+          if(!res->done && rho_dot == R_NilValue)
+            REPROTECT(rho_dot = VALC_dot_env(arg_value, set), ipx_dot);
         }
-      } else { // must have been `alike` eval
-        SETCAR(err_msg, eval_res);
-      }
-      UNPROTECT(3);
-      return(err_msg);
+        SEXP err;
+        pass = VALC_eval_leaf(
+          VECTOR_ELT(leaves, op.leaf), op.code,
+          op.code == VALC_OP_TEMPLATE && op.aux & VALC_OP_AUX_PURE ?
+            memo : R_NilValue,
+          op.leaf, rho_dot,
+          leaf_res + op.leaf, tpl_vals, arg_value, arg_lang, arg_tag,
+          lang_full, set, &err
+        );
+        if(!pass && !set.no_msg) {
+          PROTECT(err);
+          if(errs == R_NilValue)
+            REPROTECT(errs = allocVector(VECSXP, prog->n_leaves), ipx);
+          SET_VECTOR_ELT(errs, err_n++, err);
+          UNPROTECT(1);
+        }
+        ++ip;
+      } break;
+      case VALC_OP_AND: ip = pass ? ip + 1 : op.jump; break;
+      case VALC_OP_OR_INIT: or_chk[or_n++] = err_n; ++ip; break;
+      case VALC_OP_OR: ip = pass ? op.jump : ip + 1; break;
+      case VALC_OP_OR_END: {
+        // Passing branch, so drop errors from the failing one, if any
+        --or_n;
+        if(pass) err_n = or_chk[or_n];
+        ++ip;
+      } break;
+      default:
+        // nocov start
+        error(
+          "Internal Error: unknown vetr op %d; contact maintainer.", op.code
+        );
+        // nocov end
     }
+  }
+  if(pass || set.no_msg) {
     UNPROTECT(2);
-    return(eval_res);  // this should be `TRUE`
-  } else {
-    error("Internal Error: unexpected parse mode %d", mode);  // nocov
+    return ScalarLogical(pass);
   }
-  error("Internal Error: should never get here");             // nocov
-  return(R_NilValue);  // nocov Should never get here
+  SEXP res = R_NilValue;
+  PROTECT_INDEX ipx2;
+  PROTECT_WITH_INDEX(res, &ipx2);
+  for(int i = err_n - 1; i >= 0; --i)
+    REPROTECT(res = CONS(VECTOR_ELT(errs, i), res), ipx2);
+  UNPROTECT(3);
+  return res;
 }
 /* -------------------------------------------------------------------------- *\
 \* -------------------------------------------------------------------------- */
 /*
-TBD if this should call `VALC_parse` directly or not
+Set up the leaf outcomes for a run of `prog`, using `stack` if it is large
+enough (it must have `VALC_LEAF_STACK` elements)
+*/
+struct VALC_leaf_res * VALC_leaf_res_init(
+  SEXP prog, struct VALC_leaf_res * stack
+) {
+  int n_leaves = VALC_prog_get(prog)->n_leaves;
+  struct VALC_leaf_res * leaf_res = stack;
+  if(n_leaves > VALC_LEAF_STACK)
+    leaf_res = (struct VALC_leaf_res *)
+      R_alloc(n_leaves, sizeof(struct VALC_leaf_res));
+  for(int i = 0; i < n_leaves; ++i) leaf_res[i].done = 0;
+  return leaf_res;
+}
+/*
+Storage for the values of the template calls in `prog` that are not pure (see
+`VALC_tpl_pure`), so that the message pass does not evaluate them again.
+Constant templates evaluate to themselves so are cheap to re-evaluate.
 
-@param lang the validator expression
-@param arg_lang the substituted language being validated
-@param arg_tag the variable name being validated
-@param arg_value the value being validated
-@param lang_full solely so that we can produce error message with original call
-@param set the settings
+@return a VECSXP with one element per leaf, or R_NilValue if there are no
+  such templates; must be PROTECTed by the caller
 */
-SEXP VALC_evaluate(
-  SEXP lang, SEXP arg_lang, SEXP arg_tag, SEXP arg_value, SEXP lang_full,
-  struct VALC_settings set
+SEXP VALC_leaf_vals(SEXP prog) {
+  struct VALC_prog * prog_c = VALC_prog_get(prog);
+  SEXP leaves = VALC_prog_leaves(prog);
+  for(int i = 0; i < prog_c->n_ops; ++i) {
+    struct VALC_op op = prog_c->ops[i];
+    if(
+      op.code == VALC_OP_TEMPLATE && !(op.aux & VALC_OP_AUX_PURE) &&
+      TYPEOF(VECTOR_ELT(leaves, op.leaf)) == LANGSXP
+    )
+      return allocVector(VECSXP, prog_c->n_leaves);
+  }
+  return R_NilValue;
+}
+/*
+The two passes of `VALC_evaluate`.  They are separate so callers can avoid
+work they only need for the messages, e.g. `vetr` only looks up the argument
+expression if the first pass fails.  Both passes must be given the same
+`leaf_res` and `tpl_vals` so that the leaves are only evaluated once.
+
+`VALC_evaluate_lgl` runs the program without generating any error messages
+and returns whether it passes.  `VALC_evaluate_msg` runs it again to produce
+the messages, and returns either a pairlist of them or TRUE if it passes
+after all.
+*/
+int VALC_evaluate_lgl(
+  SEXP prog, struct VALC_leaf_res * leaf_res, SEXP tpl_vals, SEXP arg_lang,
+  SEXP arg_tag, SEXP arg_value, SEXP lang_full, struct VALC_settings set
+) {
+  struct VALC_settings set_lgl = set;
+  set_lgl.no_msg = 1;
+  return asLogical(
+    VALC_run(
+      prog, leaf_res, tpl_vals, arg_value, arg_lang, arg_tag, lang_full,
+      set_lgl
+    )
+  );
+}
+SEXP VALC_evaluate_msg(
+  SEXP prog, struct VALC_leaf_res * leaf_res, SEXP tpl_vals, SEXP arg_lang,
+  SEXP arg_tag, SEXP arg_value, SEXP lang_full, struct VALC_settings set
 ) {
   if(!IS_LANG(arg_lang))
     error("Internal Error: argument `arg_lang` must be language.");  // nocov
 
-  SEXP lang_parsed = PROTECT(VALC_parse(lang, arg_lang, set));
   SEXP res = PROTECT(
-    VALC_evaluate_recurse(
-      VECTOR_ELT(lang_parsed, 0),
-      VECTOR_ELT(lang_parsed, 1),
-      arg_value, arg_lang, arg_tag, lang_full, set
-  ) );
+    VALC_run(
+      prog, leaf_res, tpl_vals, arg_value, arg_lang, arg_tag, lang_full, set
+    )
+  );
   // Remove duplicates, if any
 
   switch(TYPEOF(res)) {
     case LGLSXP:  break;
-    case LISTSXP: {
-      SEXP res_cpy, res_next, res_next_next, res_val;
-      for(
-        res_cpy = res; res_cpy != R_NilValue;
-        res_cpy = res_next
-      ) {
-        res_next = CDR(res_cpy);
-        res_val = CAR(res_cpy);
-        if(TYPEOF(res_val) != STRSXP) {
-          // nocov start
-          error(
-            "%s%s",
-            "Internal Error: non string value in return pairlist; contact ",
-            "maintainer."
-          );
-          // nocov end
-        }
-        if(res_next == R_NilValue) break;
-        // Need to remove res_next
-        if(R_compute_identical(CAR(res_next), res_val, 16)) {
-          res_next_next = CDR(res_next);
-          SETCDR(res_cpy, res_next_next);
-      } }
-    } break;
+    case LISTSXP: res = ALIKEC_dedupe_msg(res); break;
     default: {
       // nocov start
       error(
@@ -354,7 +566,53 @@ SEXP VALC_evaluate(
       // nocov end
     }
   }
-  UNPROTECT(2);  // This seems a bit stupid, PROTECT/UNPROTECT
+  UNPROTECT(1);
+  return(res);
+}
+/*
+Compiled programs come from the program cache, see `VALC_compile_cached`.
+
+We first run the program without generating any error messages as in the
+common case the program passes, possibly after some `||` branches fail.  Only
+if it fails overall do we run it again to produce the messages.  Custom
+expressions and templates are not re-evaluated on the second run.
+
+@param lang the validator expression
+@param arg_lang the substituted language being validated
+@param arg_tag the variable name being validated
+@param arg_value the value being validated
+@param lang_full solely so that we can produce error message with original call
+@param set the settings
+*/
+SEXP VALC_evaluate(
+  SEXP lang, SEXP arg_lang, SEXP arg_tag, SEXP arg_value, SEXP lang_full,
+  struct VALC_settings set
+) {
+  if(!IS_LANG(arg_lang))
+    error("Internal Error: argument `arg_lang` must be language.");  // nocov
+
+  // Program could get dropped from the cache while we run it if a custom
+  // expression itself calls `vet`, so must PROTECT
+
+  SEXP prog = PROTECT(VALC_compile_cached(lang, set));
+  struct VALC_leaf_res leaf_res_stack[VALC_LEAF_STACK];
+  struct VALC_leaf_res * leaf_res = VALC_leaf_res_init(prog, leaf_res_stack);
+  SEXP tpl_vals = PROTECT(VALC_leaf_vals(prog));
+
+  SEXP res;
+  if(
+    VALC_evaluate_lgl(
+      prog, leaf_res, tpl_vals, arg_lang, arg_tag, arg_value, lang_full, set
+  ) ) {
+    res = ScalarLogical(1);
+  } else if(set.no_msg) {
+    res = ScalarLogical(0);
+  } else {
+    res = VALC_evaluate_msg(
+      prog, leaf_res, tpl_vals, arg_lang, arg_tag, arg_value, lang_full, set
+    );
+  }
+  UNPROTECT(2);
   return(res);
 }
 SEXP VALC_evaluate_ext(
@@ -22,17 +22,23 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 static const
 R_CallMethodDef callMethods[] = {
   {"validate", (DL_FUNC) &VALC_validate, 8},
-  {"validate_args", (DL_FUNC) &VALC_validate_args, 5},
+  {"validate_args", (DL_FUNC) &VALC_validate_args, 4},
   {"name_sub", (DL_FUNC) &VALC_name_sub_ext, 2},
   {"symb_sub", (DL_FUNC) &VALC_sub_symbol_ext, 2},
   {"parse", (DL_FUNC) &VALC_parse_ext, 3},
+  {"compile", (DL_FUNC) &VALC_compile_ext, 3},
+  {"settings_compile", (DL_FUNC) &VALC_settings_compile, 1},
+  {"settings_as_list", (DL_FUNC) &VALC_settings_as_list, 1},
   {"remove_parens", (DL_FUNC) &VALC_remove_parens, 1},
   {"eval_check", (DL_FUNC) &VALC_evaluate_ext, 6},
   {"all", (DL_FUNC) &VALC_all_ext, 1},
   {"track_hash", (DL_FUNC) &VALC_track_hash_test, 2},
   {"default_hash_fun", (DL_FUNC) &VALC_default_hash_fun, 1},
+  {"parse_cache_stats", (DL_FUNC) &VALC_parse_cache_stats, 1},
 
   {"alike_ext", (DL_FUNC) &ALIKEC_alike_ext, 5},
+  {"alike_lgl_ext", (DL_FUNC) &ALIKEC_alike_lgl_ext, 4},
+  {"schema", (DL_FUNC) &ALIKEC_schema_ext, 1},
   {"typeof", (DL_FUNC) &ALIKEC_typeof, 1},
   {"mode", (DL_FUNC) &ALIKEC_mode, 1},
   {"type_alike", (DL_FUNC) &ALIKEC_type_alike, 4},
@@ -55,9 +61,11 @@ R_CallMethodDef callMethods[] = {
   {"match_call", (DL_FUNC) &ALIKEC_match_call, 3},
   {"abstract_ts", (DL_FUNC) &ALIKEC_abstract_ts, 2},
   {"env_track", (DL_FUNC) &ALIKEC_env_track_test, 3},
+  {"alloc_test", (DL_FUNC) &ALIKEC_alloc_test, 3},
   {"msg_sort", (DL_FUNC) &ALIKEC_sort_msg_ext, 1},
   {"msg_merge", (DL_FUNC) &ALIKEC_merge_msg_ext, 1},
   {"msg_merge_2", (DL_FUNC) &ALIKEC_merge_msg_2_ext, 1},
+  {"msg_dedupe", (DL_FUNC) &ALIKEC_dedupe_msg_ext, 1},
   {"hash_test", (DL_FUNC) &pfHashTest, 2},
   {"hash_test2", (DL_FUNC) &pfHashTest2, 2},
   {"find_fun", (DL_FUNC) &ALIKEC_findFun_ext, 2},
@@ -77,6 +85,7 @@ R_CallMethodDef callMethods[] = {
   {"test_add_szt", (DL_FUNC) &CSR_test_add_szt, 0},
   {"test_smprintfx", (DL_FUNC) &CSR_test_smprintfx, 0},
   {"test_strappend2", (DL_FUNC) &CSR_test_strappend2, 0},
+  {"test_strbuf", (DL_FUNC) &CSR_test_strbuf, 0},
 
   {NULL, NULL, 0}
 };
@@ -96,7 +105,22 @@ void R_init_vetr(DllInfo *info)
   VALC_SYM_paren = install("(");
   VALC_SYM_current = install("current");
   VALC_SYM_errmsg = install("err.msg");
+  VALC_SYM_arg = install(".VETR_DOT");
+  VALC_SYM_prog = install("vetr_program");
+  VALC_SYM_pure = install("vetr.pure");
+  VALC_SYM_vetr_set = install(".VETR_SETTINGS");
+  VALC_SYM_settings = install("vetr_settings");
+  VALC_SYM_not = install("!");
+  VALC_SYM_isna = install("is.na");
+  VALC_SYM_isfinite = install("is.finite");
+  VALC_SYM_gte = install(">=");
+  VALC_SYM_lte = install("<=");
+  VALC_SYM_gt = install(">");
+  VALC_SYM_lt = install("<");
+  VALC_SYM_minus = install("-");
+  VALC_SYM_elementwise = install("vetr.elementwise");
   VALC_TRUE = ScalarLogical(1);
+  VALC_parse_cache_init();
 
   // Some overlap with previous since these used to be separate packages...
 
@@ -108,7 +132,9 @@ void R_init_vetr(DllInfo *info)
   ALIKEC_SYM_deparse = install("deparse");
   ALIKEC_SYM_nlines = install("nlines");
   ALIKEC_SYM_widthcutoff = install("width.cutoff");
-  ALIKEC_SYM_getOption = install("getOption");
+  ALIKEC_SYM_width = install("width");
+  ALIKEC_SYM_prompt = install("prompt");
+  ALIKEC_SYM_continue = install("continue");
   ALIKEC_SYM_matchcall = install("match.call");
   ALIKEC_SYM_current = install("current");
   ALIKEC_SYM_attributes = install("attributes");
@@ -116,5 +142,6 @@ void R_init_vetr(DllInfo *info)
   ALIKEC_SYM_colnames = install("colnames");
   ALIKEC_SYM_length = install("length");
   ALIKEC_SYM_syntacticnames = install("syntacticnames");
+  ALIKEC_SYM_schema = install("vetr_schema");
 }
 
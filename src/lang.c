@@ -462,13 +462,13 @@ Determine whether objects should be compared as calls or as formulas; the main
 difference in treatment is that calls are match-called if possible, and also
 that for calls constants need not be the same
 
-Return a list (vector) with the status, error message, the matched language
-object, the original language object, and index within the langauge object of
-the problem if there is one (relative to the matched object)
+`curr_cpy_par` must be a PROTECTed one element pairlist containing a copy of
+`current`, which is modified to mark the location of the problem if there is
+one.
 */
 
-SEXP ALIKEC_lang_alike_core(
-  SEXP target, SEXP current, struct VALC_settings set
+static struct ALIKEC_res_lang ALIKEC_lang_alike_run(
+  SEXP target, SEXP current, SEXP curr_cpy_par, struct VALC_settings set
 ) {
   SEXP match_env = set.env;
   SEXPTYPE tar_type = TYPEOF(target), cur_type = TYPEOF(current);
@@ -519,12 +519,27 @@ SEXP ALIKEC_lang_alike_core(
   // Check if alike; originally we would modify a copy of current, which is
   // why we send curr_cpy_par
 
-  SEXP curr_cpy_par = PROTECT(list1(duplicate(current)));
   struct ALIKEC_rec_track rec = ALIKEC_rec_def();
   struct ALIKEC_res_lang res = ALIKEC_lang_alike_rec(
     target, curr_cpy_par, tar_hash, cur_hash, rev_hash, tar_varnum, cur_varnum,
     formula, match_call, match_env, set, rec
   );
+  UNPROTECT(1);
+  return res;
+}
+/*
+Return a list (vector) with the status, error message, the matched language
+object, the original language object, and index within the langauge object of
+the problem if there is one (relative to the matched object)
+*/
+
+SEXP ALIKEC_lang_alike_core(
+  SEXP target, SEXP current, struct VALC_settings set
+) {
+  SEXP curr_cpy_par = PROTECT(list1(duplicate(current)));
+  struct ALIKEC_res_lang res =
+    ALIKEC_lang_alike_run(target, current, curr_cpy_par, set);
+
   // Save our results in a SEXP to simplify testing
   const char * names[6] = {
     "success", "message", "call.match", "call.ind", "call.ind.sub.par",
@@ -543,50 +558,51 @@ SEXP ALIKEC_lang_alike_core(
 
     SET_VECTOR_ELT(
       res_fin, 1,
-      ALIKEC_res_msg_def(
-        res.msg_strings.tar_pre, res.msg_strings.target,
-        res.msg_strings.act_pre, res.msg_strings.actual
-    ) );
+      ALIKEC_res_msg_as_sxp(
+        ALIKEC_res_msg_def(
+          res.msg_strings.tar_pre, res.msg_strings.target,
+          res.msg_strings.act_pre, res.msg_strings.actual
+    ) ) );
     SET_VECTOR_ELT(res_fin, 2, CAR(curr_cpy_par));
     SET_VECTOR_ELT(res_fin, 3, VECTOR_ELT(rec_ind, 0));
     SET_VECTOR_ELT(res_fin, 4, VECTOR_ELT(rec_ind, 1));
     SET_VECTOR_ELT(res_fin, 5, current);
     UNPROTECT(1);
   }
-  UNPROTECT(4);
+  UNPROTECT(3);
   return res_fin;
 }
 /*
   Translate result into res_sub for use by alike
 
-  Probalby some inefficiency in the C -> SEXP -> C translations going on; this
-  is happening mostly for legacy reason so should probably clean up to stick to
-  C at some point.  One of the changes (amongst others) is that we no longer care
-  about recording the call / language that caused the problem since we're
-  refering directly to the original object
+  We no longer care about recording the call / language that caused the
+  problem since we're refering directly to the original object, so beyond the
+  message strings all we need is the index of the problem for the wrap.
 */
 struct ALIKEC_res_sub ALIKEC_lang_alike_internal(
   SEXP target, SEXP current, struct VALC_settings set
 ) {
-  SEXP lang_res = PROTECT(ALIKEC_lang_alike_core(target, current, set));
+  SEXP curr_cpy_par = PROTECT(list1(duplicate(current)));
+  struct ALIKEC_res_lang lang_res =
+    ALIKEC_lang_alike_run(target, current, curr_cpy_par, set);
 
   struct ALIKEC_res_sub res = ALIKEC_res_sub_def();
-  if(asInteger(VECTOR_ELT(lang_res, 0))) {
-    PROTECT(res.message);  // stack balance
-  } else {
+  if(!lang_res.success) {
     res.success = 0;
-    res.message = PROTECT(VECTOR_ELT(lang_res, 1));
-
+    res.message = ALIKEC_res_msg_def(
+      lang_res.msg_strings.tar_pre, lang_res.msg_strings.target,
+      lang_res.msg_strings.act_pre, lang_res.msg_strings.actual
+    );
     // Deal with wrap
 
-    SEXP lang_ind = VECTOR_ELT(lang_res, 3);
-    SEXP lang_ind_sub = VECTOR_ELT(lang_res, 4);
-
-    SEXP wrap = VECTOR_ELT(res.message, 1);
-    SET_VECTOR_ELT(wrap, 0, lang_ind);
-    SET_VECTOR_ELT(wrap, 1, lang_ind_sub);
+    SEXP rec_ind = PROTECT(ALIKEC_rec_ind_as_lang(lang_res.rec));
+    SEXP wrap = PROTECT(allocVector(VECSXP, 2));
+    SET_VECTOR_ELT(wrap, 0, VECTOR_ELT(rec_ind, 0));
+    SET_VECTOR_ELT(wrap, 1, VECTOR_ELT(rec_ind, 1));
+    res.message.wrap = wrap;
+    UNPROTECT(2);
   }
-  UNPROTECT(2);
+  UNPROTECT(1);
   return res;
 }
 /*
@@ -605,13 +621,8 @@ SEXP ALIKEC_lang_alike_chr_ext(
 ) {
   struct VALC_settings set = VALC_settings_init();
   set.env = match_env;
-  SEXP res = PROTECT(ALIKEC_lang_alike_internal(target, current, set).message);
-  SEXP res_str;
-  if(res != R_NilValue) {
-    res_str = PROTECT(VECTOR_ELT(res, 0));
-  } else {
-    res_str = PROTECT(mkString(""));
-  }
-  UNPROTECT(2);
-  return res_str;
+  struct ALIKEC_res_sub res =
+    ALIKEC_lang_alike_internal(target, current, set);
+  if(res.success) return mkString("");
+  return ALIKEC_res_strings_to_SEXP(res.message.strings);
 }
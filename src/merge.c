@@ -24,23 +24,56 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
  */
 
 struct ALIKEC_sort_dat {
-  const char * string;
+  SEXP msg;
   R_xlen_t index;
 };
 
 /*
- * Compare two character vectors a and b to determine if a is less than b or
- * equal.  The trick is that we're actually comparing the first, third, and
- * fourth values of the character vectors
- *
- * We assume we wont get non terminated strings from SEXPs...
+ * Compare two CHARSXPs, most of the strings we compare are the same cached
+ * CHARSXP so we check the pointers first
+ */
+
+static int ALIKEC_chr_comp(SEXP a, SEXP b) {
+  return a == b ? 0 : strcmp(CHAR(a), CHAR(b));
+}
+/*
+ * Compare two messages field by field, using the first, second, fourth, and
+ * fifth elements, and then the third to break ties.  One length messages are
+ * compared on their only element against the first element of the other, and
+ * sort ahead of five length messages they tie with.  Finally the original
+ * index breaks any remaining ties so the order is reproducible.
  */
 
 int ALIKEC_merge_comp(const void *p, const void *q) {
-  struct ALIKEC_sort_dat a = *(struct ALIKEC_sort_dat *) p;
-  struct ALIKEC_sort_dat b = *(struct ALIKEC_sort_dat *) q;
+  const struct ALIKEC_sort_dat * a = (const struct ALIKEC_sort_dat *) p;
+  const struct ALIKEC_sort_dat * b = (const struct ALIKEC_sort_dat *) q;
+  const R_xlen_t fields[5] = {0, 1, 3, 4, 2};
+  R_xlen_t a_len = XLENGTH(a->msg), b_len = XLENGTH(b->msg);
+
+  int res = ALIKEC_chr_comp(STRING_ELT(a->msg, 0), STRING_ELT(b->msg, 0));
+
+  if(!res && a_len != b_len) res = a_len < b_len ? -1 : 1;
+  for(R_xlen_t i = 1; !res && i < a_len; i++) {
+    res = ALIKEC_chr_comp(
+      STRING_ELT(a->msg, fields[i]), STRING_ELT(b->msg, fields[i])
+    );
+  }
+  if(!res) res = (a->index > b->index) - (a->index < b->index);
+  return res;
+}
+/*
+ * Whether two sorted messages belong in the same merge group, i.e. they are
+ * both five long and all but the third elements are the same
+ */
 
-  return(strcmp(a.string, b.string));
+static int ALIKEC_merge_same(SEXP a, SEXP b) {
+  if(XLENGTH(a) != 5 || XLENGTH(b) != 5) return 0;
+  const R_xlen_t fields[4] = {0, 1, 3, 4};
+  for(int i = 0; i < 4; i++) {
+    if(ALIKEC_chr_comp(STRING_ELT(a, fields[i]), STRING_ELT(b, fields[i])))
+      return 0;
+  }
+  return 1;
 }
 /*
  * Sort a list of 5 length character vectors by the 1st, 2nd, 4th, and 5th
@@ -53,7 +86,7 @@ int ALIKEC_merge_comp(const void *p, const void *q) {
  * Example: c("`names(letters)`", "be", "character", "is", "integer")
  */
 
-SEXP ALIKEC_sort_msg(SEXP msgs, struct VALC_settings set) {
+SEXP ALIKEC_sort_msg(SEXP msgs) {
   if(TYPEOF(msgs) != VECSXP) {
     error("Expected list argument, got %s", type2char(TYPEOF(msgs)));
   }
@@ -74,38 +107,20 @@ SEXP ALIKEC_sort_msg(SEXP msgs, struct VALC_settings set) {
       );
       // nocov end
     }
-    const char * sort_string = "";
-    if(XLENGTH(str_elt) == 1) {
-      sort_string = CHAR(asChar(str_elt));
-    } else {
-      // delimiters to minimize susceptibility to frame shift, but obviously not
-      // a guarantee
-
-      sort_string = CSR_smprintf6(
-        set.nchar_max, "%s <:> %s <:> %s <:> %s <:> %s%s",
-        CHAR(STRING_ELT(str_elt, 0)), CHAR(STRING_ELT(str_elt, 1)),
-        CHAR(STRING_ELT(str_elt, 3)), CHAR(STRING_ELT(str_elt, 4)),
-        CHAR(STRING_ELT(str_elt, 2)), ""
-      );
-    }
-    sort_dat[i] = (struct ALIKEC_sort_dat) {
-      sort_string,
-      i
-    };
+    sort_dat[i] = (struct ALIKEC_sort_dat) {str_elt, i};
   }
   qsort(sort_dat, vec_len, sizeof(struct ALIKEC_sort_dat), ALIKEC_merge_comp);
 
   SEXP msg_sort = PROTECT(allocVector(VECSXP, vec_len));
 
   for(i = 0; i < vec_len; i++) {
-    SET_VECTOR_ELT(msg_sort, i, VECTOR_ELT(msgs, sort_dat[i].index));
+    SET_VECTOR_ELT(msg_sort, i, sort_dat[i].msg);
   }
   UNPROTECT(1);
   return(msg_sort);
 }
 SEXP ALIKEC_sort_msg_ext(SEXP msgs) {
-  struct VALC_settings set = VALC_settings_vet(R_NilValue, R_BaseEnv);
-  return ALIKEC_sort_msg(msgs, set);
+  return ALIKEC_sort_msg(msgs);
 }
 
 /*
@@ -125,23 +140,17 @@ SEXP ALIKEC_merge_msg(SEXP msgs, struct VALC_settings set) {
     // 1. Sort the strings (really only need to do this if longer than 3, but oh
     // well
 
-    SEXP msg_sort = PROTECT(ALIKEC_sort_msg(msgs, set));
+    SEXP msg_sort = PROTECT(ALIKEC_sort_msg(msgs));
     R_xlen_t groups = 1;
 
     // Determine how many groups of similar things there are in our list
 
     for(R_xlen_t i=1; i < len; i++) {
-      SEXP v_elt = VECTOR_ELT(msg_sort, i);
-      SEXP v_elt_prv = VECTOR_ELT(msg_sort, i - 1);
       if(
-        XLENGTH(v_elt) == 1 ||
-        strcmp(CHAR(STRING_ELT(v_elt, 0)), CHAR(STRING_ELT(v_elt_prv, 0))) ||
-        strcmp(CHAR(STRING_ELT(v_elt, 1)), CHAR(STRING_ELT(v_elt_prv, 1))) ||
-        strcmp(CHAR(STRING_ELT(v_elt, 3)), CHAR(STRING_ELT(v_elt_prv, 3))) ||
-        strcmp(CHAR(STRING_ELT(v_elt, 4)), CHAR(STRING_ELT(v_elt_prv, 4)))
-      ) {
+        !ALIKEC_merge_same(
+          VECTOR_ELT(msg_sort, i), VECTOR_ELT(msg_sort, i - 1)
+      ) )
         ++groups;
-      }
     }
     // If we need to condense the list, then allocate it, otherwise just return
     // the original list
@@ -150,9 +159,10 @@ SEXP ALIKEC_merge_msg(SEXP msgs, struct VALC_settings set) {
       res = PROTECT(allocVector(VECSXP, groups));
       R_xlen_t k = 0;      // count the index in our result vector
       R_xlen_t j = 0;      // count how many elements in group
-      // this will be the concatented second value in our vectors
+      // this will be the concatented second value in our vectors, re-used
+      // for each group
 
-      const char * target = "";
+      struct CSR_strbuf target = CSR_strbuf_init(128, set.nchar_max);
 
       for(R_xlen_t i=0; i < len; i++) {
 
@@ -164,12 +174,8 @@ SEXP ALIKEC_merge_msg(SEXP msgs, struct VALC_settings set) {
         // Note, we'll only ever acces v_elt_nxt if we're not at the last value
         // in the loop so it is okay for it to be R_NilValue in that iteration
 
-        int next_diff = (i == len - 1) ||
-          XLENGTH(v_elt) == 1 ||
-          strcmp(CHAR(STRING_ELT(v_elt, 0)), CHAR(STRING_ELT(v_elt_nxt, 0))) ||
-          strcmp(CHAR(STRING_ELT(v_elt, 1)), CHAR(STRING_ELT(v_elt_nxt, 1))) ||
-          strcmp(CHAR(STRING_ELT(v_elt, 3)), CHAR(STRING_ELT(v_elt_nxt, 3))) ||
-          strcmp(CHAR(STRING_ELT(v_elt, 4)), CHAR(STRING_ELT(v_elt_nxt, 4)));
+        int next_diff =
+          (i == len - 1) || !ALIKEC_merge_same(v_elt, v_elt_nxt);
 
         if(next_diff) {
           SEXP v_elt_d = duplicate(v_elt);
@@ -178,11 +184,9 @@ SEXP ALIKEC_merge_msg(SEXP msgs, struct VALC_settings set) {
           // append with, "or" if necessary and write
 
           if(j) {
-            target = CSR_smprintf4(
-              set.nchar_max, "%s, or %s",
-              target, CHAR(STRING_ELT(v_elt_d, 2)), "", ""
-            );
-            SET_STRING_ELT(v_elt_d, 2, mkChar(target));
+            CSR_strbuf_add(&target, ", or ");
+            CSR_strbuf_add(&target, CHAR(STRING_ELT(v_elt_d, 2)));
+            SET_STRING_ELT(v_elt_d, 2, mkChar(target.buff));
           }
           j = 0;
           ++k;
@@ -190,11 +194,9 @@ SEXP ALIKEC_merge_msg(SEXP msgs, struct VALC_settings set) {
           // more than one value, but not done yet
 
           if(j) {
-            target = CSR_smprintf4(
-              set.nchar_max, "%s, %s",
-              target, CHAR(STRING_ELT(v_elt, 2)), "", ""
-            );
-          } else target = CHAR(STRING_ELT(v_elt, 2));
+            CSR_strbuf_add(&target, ", ");
+          } else CSR_strbuf_reset(&target);
+          CSR_strbuf_add(&target, CHAR(STRING_ELT(v_elt, 2)));
           ++j;
         }
       }
@@ -242,3 +244,68 @@ SEXP ALIKEC_merge_msg_2_ext(SEXP msgs) {
   struct VALC_settings set = VALC_settings_vet(R_NilValue, R_BaseEnv);
   return ALIKEC_merge_msg_2(msgs, set);
 }
+/*
+ * Drop repeated messages from a pairlist of character vectors, keeping the
+ * first instance of each.
+ *
+ * Messages are hashed on their contents so this is linear in the number of
+ * messages instead of comparing all pairs.  They are compared element-wise,
+ * which is what `identical` amounts to for the character vectors we produce.
+ * The table is `R_alloc`ed so there is no need to free it.
+ */
+
+static size_t ALIKEC_msg_hash(SEXP msg) {
+  size_t hash = 2166136261U;
+  for(R_xlen_t i = 0; i < XLENGTH(msg); i++) {
+    const unsigned char * chr =
+      (const unsigned char *) CHAR(STRING_ELT(msg, i));
+    for(; *chr; ++chr) hash = (hash ^ *chr) * 16777619U;
+    hash = (hash ^ 0xff) * 16777619U;  // element boundary
+  }
+  return hash;
+}
+static int ALIKEC_msg_equal(SEXP a, SEXP b) {
+  if(XLENGTH(a) != XLENGTH(b)) return 0;
+  for(R_xlen_t i = 0; i < XLENGTH(a); i++) {
+    if(ALIKEC_chr_comp(STRING_ELT(a, i), STRING_ELT(b, i))) return 0;
+  }
+  return 1;
+}
+SEXP ALIKEC_dedupe_msg(SEXP msgs) {
+  R_xlen_t len = xlength(msgs);
+  if(len < 2) return msgs;
+
+  size_t cap = 8;
+  while(cap < 2 * (size_t) len) cap <<= 1;
+  size_t mask = cap - 1;
+  SEXP * tbl = (SEXP *) R_alloc(cap, sizeof(SEXP));
+  for(size_t i = 0; i < cap; ++i) tbl[i] = NULL;
+
+  SEXP prev = R_NilValue;
+  for(SEXP el = msgs; el != R_NilValue; el = CDR(el)) {
+    SEXP msg = CAR(el);
+    if(TYPEOF(msg) != STRSXP) {
+      // nocov start
+      error(
+        "%s%s",
+        "Internal Error: non string value in return pairlist; contact ",
+        "maintainer."
+      );
+      // nocov end
+    }
+    size_t i = ALIKEC_msg_hash(msg) & mask;
+    while(tbl[i] && !ALIKEC_msg_equal(tbl[i], msg)) i = (i + 1) & mask;
+
+    // first element is never a duplicate so `prev` is set when we need it
+
+    if(tbl[i]) SETCDR(prev, CDR(el));
+    else {
+      tbl[i] = msg;
+      prev = el;
+    }
+  }
+  return msgs;
+}
+SEXP ALIKEC_dedupe_msg_ext(SEXP msgs) {
+  return ALIKEC_dedupe_msg(msgs);
+}
@@ -17,17 +17,28 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 */
 
 #include "alike.h"
+#include "validate.h"
 #include "pfhash.h"
 #include <time.h>
 
 // - Helper Functions ----------------------------------------------------------
 
 /* equivalent to `mode` in R, note this is a bit approximate and just trying to
-hit the obvious corner cases between `typeof` and `mode`*/
+hit the obvious corner cases between `typeof` and `mode`
+
+The result for each type is created once and then reused since implicit
+classes are looked up on every class comparison.  Callers must not modify
+it.*/
+
+#define ALIKEC_MODE_TYPES 32
 
 SEXP ALIKEC_mode(SEXP obj) {
+  static SEXP modes[ALIKEC_MODE_TYPES];
+  SEXPTYPE type = TYPEOF(obj);
+  if(type < ALIKEC_MODE_TYPES && modes[type]) return modes[type];
+
   const char * class;
-  switch(TYPEOF(obj)) {
+  switch(type) {
     case NILSXP: class = "NULL"; break;
     case SYMSXP: class = "name"; break;
     case FUNSXP:
@@ -36,9 +47,15 @@ SEXP ALIKEC_mode(SEXP obj) {
     case CLOSXP: class = "function"; break;
     case LANGSXP: class = "call"; break;
     case REALSXP: class = "numeric"; break;
-    default: class = type2char(TYPEOF(obj));
+    default: class = type2char(type);
   }
-  return(mkString(class));
+  SEXP mode = mkString(class);
+  if(type < ALIKEC_MODE_TYPES) {
+    R_PreserveObject(mode);
+    VALC_not_mutable(mode);
+    modes[type] = mode;
+  }
+  return(mode);
 }
 /*
 returns specified class, or implicit class if none
@@ -48,14 +65,57 @@ SEXP ALIKEC_class(SEXP obj, SEXP class) {
   return class;
 }
 /*
-run `getOption` from C
+equivalent to `getOption` from C, but looks up `.Options` directly instead of
+evaluating an R call
 */
-SEXP ALIKEC_getopt(const char * opt) {
-  SEXP opt_call = PROTECT(list2(ALIKEC_SYM_getOption, mkString(opt)));
-  SET_TYPEOF(opt_call, LANGSXP);
-  SEXP opt_val = PROTECT(eval(opt_call, R_BaseEnv));
-  UNPROTECT(2);
-  return opt_val;
+SEXP ALIKEC_getopt(SEXP opt) {
+  return GetOption1(opt);
+}
+/*
+Snapshot of the options used when rendering messages
+
+Rendering a single failure may pad or quote several calls, so rather than
+look up and parse the options each time we keep the parsed values along with
+the option objects they came from.  `options()` replaces the value objects
+when options are set, so the snapshot is valid for as long as the objects
+found in `.Options` are the same.  We preserve the objects we record so that
+their memory cannot be re-used for new values, which also keeps the prompt
+strings valid.
+*/
+static SEXP ALIKEC_opts_vals[3];
+static struct ALIKEC_opts ALIKEC_opts_snap;
+
+struct ALIKEC_opts ALIKEC_opts_get() {
+  SEXP syms[3] = {ALIKEC_SYM_width, ALIKEC_SYM_prompt, ALIKEC_SYM_continue};
+  SEXP vals[3];
+  int i, stale = 0;
+
+  for(i = 0; i < 3; ++i) {
+    vals[i] = ALIKEC_getopt(syms[i]);
+    if(vals[i] != ALIKEC_opts_vals[i]) stale = 1;
+  }
+  if(stale) {
+    for(i = 0; i < 3; ++i) {
+      R_PreserveObject(vals[i]);
+      if(ALIKEC_opts_vals[i]) R_ReleaseObject(ALIKEC_opts_vals[i]);
+      ALIKEC_opts_vals[i] = vals[i];
+    }
+    SEXP prompt = vals[1], cont = vals[2];
+    ALIKEC_opts_snap.width = asInteger(vals[0]);
+    if(
+      TYPEOF(prompt) != STRSXP || TYPEOF(cont) != STRSXP ||
+      asChar(prompt) == NA_STRING || asChar(cont) == NA_STRING
+    ) {
+      // nocov start not possible to actually set these as options
+      ALIKEC_opts_snap.prompt = "> ";
+      ALIKEC_opts_snap.cont = "+ ";
+    } else {
+      // nocov end
+      ALIKEC_opts_snap.prompt = CHAR(asChar(prompt));
+      ALIKEC_opts_snap.cont = CHAR(asChar(cont));
+    }
+  }
+  return ALIKEC_opts_snap;
 }
 // - Abstraction ---------------------------------------------------------------
 /*
@@ -94,11 +154,236 @@ SEXP ALIKEC_abstract_ts(SEXP x, SEXP attr) {
   return x_cp;
 }
 /*
+Native deparser for the calls we render in error messages
+
+Handles symbols, scalar constants, function calls, `[[`, `[`, `$` and `@`
+subsetting, `::`, parentheses, and binary and unary operators with operands
+that are not themselves operator calls.  For these the output is the same as
+that of `deparse`, provided it fits in `width_cutoff` bytes so that `deparse`
+would not have broken it into several lines.
+
+Each function returns 0 to give up, in which case the caller should fall back
+to `deparse`.  This happens for non-syntactic or non-ASCII names, missing
+arguments, constants that are not simple scalars, nested operators (where
+`deparse` may add parentheses), and other language constructs.
+*/
+struct ALIKEC_dep_buff {
+  char * buff;
+  size_t len;
+  size_t max;
+};
+static int ALIKEC_dep_put(struct ALIKEC_dep_buff * b, const char * x) {
+  size_t x_len = strlen(x);
+  if(x_len > b->max - b->len) return 0;
+  memcpy(b->buff + b->len, x, x_len);
+  b->len += x_len;
+  b->buff[b->len] = '\0';
+  return 1;
+}
+static int ALIKEC_dep_is_ascii(const char * x) {
+  for(; *x; ++x) if(*x < 0x20 || *x > 0x7e) return 0;
+  return 1;
+}
+static int ALIKEC_dep_sym(struct ALIKEC_dep_buff * b, SEXP sym) {
+  if(TYPEOF(sym) != SYMSXP) return 0;
+  const char * name = CHAR(PRINTNAME(sym));
+  if(!*name || !ALIKEC_dep_is_ascii(name) || !ALIKEC_is_valid_name(name))
+    return 0;
+  return ALIKEC_dep_put(b, name);
+}
+/*
+Classify operators:
+
+* 0 not an operator
+* 1 binary with spaces around it, e.g. `a + b`
+* 2 binary without spaces, e.g. `a/b`
+* 3 unary or binary, e.g. `-a` or `a - b`
+* 4 unary only
+*/
+static int ALIKEC_dep_op_type(const char * name) {
+  const char * spaced[12] = {
+    "*", "==", "!=", "<", ">", "<=", ">=", "&", "&&", "|", "||", "~"
+  };
+  const char * tight[5] = {"/", "^", ":", "%%", "%/%"};
+  size_t len = strlen(name);
+  int i;
+
+  if(!strcmp(name, "+") || !strcmp(name, "-")) return 3;
+  if(!strcmp(name, "!")) return 4;
+  for(i = 0; i < 5; ++i) if(!strcmp(name, tight[i])) return 2;
+  for(i = 0; i < 12; ++i) if(!strcmp(name, spaced[i])) return 1;
+  if(len > 2 && name[0] == '%' && name[len - 1] == '%') return 1;
+  return 0;
+}
+/*
+Whether `x` is a call that deparses as an operator, which we do not allow as
+an operand to avoid having to reproduce `deparse` precedence handling
+*/
+static int ALIKEC_dep_is_op_call(SEXP x) {
+  if(TYPEOF(x) != LANGSXP || TYPEOF(CAR(x)) != SYMSXP) return 0;
+  R_xlen_t n = xlength(CDR(x));
+  int type = ALIKEC_dep_op_type(CHAR(PRINTNAME(CAR(x))));
+  return
+    ((type == 1 || type == 2 || type == 3) && n == 2) ||
+    ((type == 3 || type == 4) && n == 1);
+}
+static int ALIKEC_dep_obj(struct ALIKEC_dep_buff * b, SEXP x);
+
+static int ALIKEC_dep_args(
+  struct ALIKEC_dep_buff * b, SEXP args, const char * open, const char * close
+) {
+  if(!ALIKEC_dep_put(b, open)) return 0;
+  for(; args != R_NilValue; args = CDR(args)) {
+    if(CAR(args) == R_MissingArg) return 0;
+    if(TAG(args) != R_NilValue) {
+      if(!ALIKEC_dep_sym(b, TAG(args)) || !ALIKEC_dep_put(b, " = "))
+        return 0;
+    }
+    if(!ALIKEC_dep_obj(b, CAR(args))) return 0;
+    if(CDR(args) != R_NilValue && !ALIKEC_dep_put(b, ", ")) return 0;
+  }
+  return ALIKEC_dep_put(b, close);
+}
+/*
+Operands must be untagged and must not be operator calls
+*/
+static int ALIKEC_dep_operand(struct ALIKEC_dep_buff * b, SEXP args) {
+  if(TAG(args) != R_NilValue || ALIKEC_dep_is_op_call(CAR(args))) return 0;
+  return ALIKEC_dep_obj(b, CAR(args));
+}
+static int ALIKEC_dep_lang(struct ALIKEC_dep_buff * b, SEXP x) {
+  SEXP head = CAR(x), args = CDR(x);
+  R_xlen_t n = xlength(args);
+
+  if(TYPEOF(head) == LANGSXP) {
+    // only `pkg::fun(...)` style calls
+    if(
+      TYPEOF(CAR(head)) != SYMSXP ||
+      (
+        CAR(head) != R_DoubleColonSymbol &&
+        CAR(head) != R_TripleColonSymbol
+      ) ||
+      !ALIKEC_dep_lang(b, head)
+    )
+      return 0;
+    return ALIKEC_dep_args(b, args, "(", ")");
+  }
+  if(TYPEOF(head) != SYMSXP) return 0;
+
+  const char * name = CHAR(PRINTNAME(head));
+  int op_type = ALIKEC_dep_op_type(name);
+
+  if(head == ALIKEC_SYM_paren_open) {
+    if(n != 1 || TAG(args) != R_NilValue) return 0;
+    return
+      ALIKEC_dep_put(b, "(") && ALIKEC_dep_obj(b, CAR(args)) &&
+      ALIKEC_dep_put(b, ")");
+  } else if(head == R_Bracket2Symbol || head == R_BracketSymbol) {
+    int dbl = head == R_Bracket2Symbol;
+    if(n < 2) return 0;
+    return
+      ALIKEC_dep_operand(b, args) &&
+      ALIKEC_dep_args(b, CDR(args), dbl ? "[[" : "[", dbl ? "]]" : "]");
+  } else if(head == R_DollarSymbol || !strcmp(name, "@")) {
+    if(n != 2 || TAG(CDR(args)) != R_NilValue) return 0;
+    return
+      ALIKEC_dep_operand(b, args) && ALIKEC_dep_put(b, name) &&
+      ALIKEC_dep_sym(b, CADR(args));
+  } else if(head == R_DoubleColonSymbol || head == R_TripleColonSymbol) {
+    if(n != 2 || TAG(args) != R_NilValue || TAG(CDR(args)) != R_NilValue)
+      return 0;
+    return
+      ALIKEC_dep_sym(b, CAR(args)) && ALIKEC_dep_put(b, name) &&
+      ALIKEC_dep_sym(b, CADR(args));
+  } else if(n == 2 && (op_type == 1 || op_type == 2 || op_type == 3)) {
+    const char * pad = op_type == 2 ? "" : " ";
+    return
+      ALIKEC_dep_operand(b, args) && ALIKEC_dep_put(b, pad) &&
+      ALIKEC_dep_put(b, name) && ALIKEC_dep_put(b, pad) &&
+      ALIKEC_dep_operand(b, CDR(args));
+  } else if(n == 1 && (op_type == 3 || op_type == 4)) {
+    return ALIKEC_dep_put(b, name) && ALIKEC_dep_operand(b, args);
+  } else if(!op_type) {
+    return ALIKEC_dep_sym(b, head) && ALIKEC_dep_args(b, args, "(", ")");
+  }
+  return 0;
+}
+/*
+Scalar constants without attributes; for doubles we limit ourselves to small
+non-negative integer values as those are the only ones for which we can easily
+be sure to match `deparse` formatting (e.g. 1e5 deparses as "1e+05")
+*/
+static int ALIKEC_dep_const(struct ALIKEC_dep_buff * b, SEXP x) {
+  char num[16];
+
+  if(x == R_NilValue) return ALIKEC_dep_put(b, "NULL");
+  if(ATTRIB(x) != R_NilValue || xlength(x) != 1) return 0;
+
+  switch(TYPEOF(x)) {
+    case LGLSXP:
+      if(asLogical(x) == NA_LOGICAL) return 0;
+      return ALIKEC_dep_put(b, asLogical(x) ? "TRUE" : "FALSE");
+    case INTSXP: {
+      int val = asInteger(x);
+      if(val == NA_INTEGER || val < 0) return 0;
+      snprintf(num, sizeof(num), "%dL", val);
+      return ALIKEC_dep_put(b, num);
+    }
+    case REALSXP: {
+      double val = asReal(x);
+      if(!R_FINITE(val) || val < 0 || val >= 1e5 || val != (int) val)
+        return 0;
+      snprintf(num, sizeof(num), "%d", (int) val);
+      return ALIKEC_dep_put(b, num);
+    }
+    case STRSXP: {
+      SEXP chr = STRING_ELT(x, 0);
+      if(chr == NA_STRING) return 0;
+      const char * str = CHAR(chr);
+      if(
+        !ALIKEC_dep_is_ascii(str) || strchr(str, '"') || strchr(str, '\\')
+      )
+        return 0;
+      return
+        ALIKEC_dep_put(b, "\"") && ALIKEC_dep_put(b, str) &&
+        ALIKEC_dep_put(b, "\"");
+    }
+  }
+  return 0;
+}
+static int ALIKEC_dep_obj(struct ALIKEC_dep_buff * b, SEXP x) {
+  switch(TYPEOF(x)) {
+    case SYMSXP: return ALIKEC_dep_sym(b, x);
+    case LANGSXP: return ALIKEC_dep_lang(b, x);
+  }
+  return ALIKEC_dep_const(b, x);
+}
+/*
+Returns a character(1L) with the deparsed object, or R_NilValue if we need to
+fall back to `deparse`
+*/
+static SEXP ALIKEC_deparse_native(SEXP obj, int width_cutoff) {
+  struct ALIKEC_dep_buff b = {
+    .buff = R_alloc((size_t) width_cutoff + 1, sizeof(char)),
+    .len = 0, .max = (size_t) width_cutoff
+  };
+  b.buff[0] = '\0';
+  if(!ALIKEC_dep_obj(&b, obj)) return R_NilValue;
+  return mkString(b.buff);
+}
+/*
 Run deparse command and return character vector with results
 
-set width_cutoff to be less than zero to use default
+set width_cutoff to be less than zero to use default.  Calls with the shapes
+we typically render in error messages are deparsed natively, and we only
+evaluate `deparse` for the rest.
 */
 SEXP ALIKEC_deparse_core(SEXP obj, int width_cutoff) {
+  SEXP native = ALIKEC_deparse_native(
+    obj, width_cutoff < 0 ? 60 : width_cutoff
+  );
+  if(native != R_NilValue) return native;
+
   SEXP quot_call = PROTECT(list2(R_QuoteSymbol, obj)), dep_call;
   SET_TYPEOF(quot_call, LANGSXP);
 
@@ -204,28 +489,14 @@ const char * ALIKEC_pad(
 
   if(lines < 0) lines = line_max;
 
-  char * res = "";
   const char * dep_prompt = "", * dep_continue = "";
 
   // Figure out what to use as prompt and continue
 
   if(pad < 0) {
-    SEXP prompt_val = PROTECT(ALIKEC_getopt("prompt"));
-    SEXP prompt_continue = PROTECT(ALIKEC_getopt("continue"));
-
-    if(
-      TYPEOF(prompt_val) != STRSXP || TYPEOF(prompt_continue) != STRSXP ||
-      asChar(prompt_val) == NA_STRING || asChar(prompt_continue) == NA_STRING
-    ) {
-      // nocov start not possible to actually set these as options
-      dep_prompt = "> ";
-      dep_continue = "+ ";
-    } else {
-      // nocov end
-      dep_prompt = CHAR(asChar(prompt_val));
-      dep_continue = CHAR(asChar(prompt_continue));
-    }
-    UNPROTECT(2);
+    struct ALIKEC_opts opts = ALIKEC_opts_get();
+    dep_prompt = opts.prompt;
+    dep_continue = opts.cont;
   } else if (pad > 0) {
     char * pad_chr = R_alloc(pad + 1, sizeof(char));
     int i;
@@ -235,16 +506,14 @@ const char * ALIKEC_pad(
   }
   // Cycle through lines
 
+  struct CSR_strbuf res = CSR_strbuf_init(256, set.nchar_max);
   for(i = 0; i < lines; i++) {
-    const char * dep_pad = "";
-    const char * dep_err = CHAR(STRING_ELT(obj, i));
-    if(!i) dep_pad = dep_prompt; else dep_pad = dep_continue;
-    res = CSR_smprintf6(
-      set.nchar_max, "%s%s%s%s%s%s", res, dep_pad, dep_err,
-      i == lines - 1 && lines < line_max ? "..." : "",
-      lines > 1 && line_max > 1 ? "\n" : "", ""
-  );}
-  return res;
+    CSR_strbuf_add(&res, i ? dep_continue : dep_prompt);
+    CSR_strbuf_add(&res, CHAR(STRING_ELT(obj, i)));
+    if(i == lines - 1 && lines < line_max) CSR_strbuf_add(&res, "...");
+    if(lines > 1 && line_max > 1) CSR_strbuf_add(&res, "\n");
+  }
+  return res.buff;
 }
 SEXP ALIKEC_pad_ext(SEXP obj, SEXP lines, SEXP pad) {
   struct VALC_settings set = VALC_settings_init();
@@ -379,7 +648,7 @@ const char * ALIKEC_pad_or_quote(
     error("Internal Error: mismatched width values; contact maintainer.");
     // nocov end
 
-  if(width < 0) width = asInteger(ALIKEC_getopt("width"));
+  if(width < 0) width = ALIKEC_opts_get().width;
   if(width <= 0 || width == NA_INTEGER) width = 80;
   SEXP lang_dep = PROTECT(ALIKEC_deparse_width(lang, width));
 
@@ -501,7 +770,7 @@ SEXP ALIKEC_string_or_true(struct ALIKEC_res_fin res, struct VALC_settings set)
     );
     return(mkString(res_str));
   }
-  return(ScalarLogical(1));
+  return(VALC_TRUE);
 }
 /*
  * variation on ALIKEC_string_or_true that returns the full vector so we can use
@@ -547,3 +816,62 @@ SEXP ALIKEC_is_dfish_ext(SEXP obj) {
   return ScalarLogical(ALIKEC_is_dfish(obj));
 }
 
+/*
+External interface purely for testing that matching objects are compared
+without allocating.
+
+R has no public allocation counter, so we infer SEXP allocations from garbage
+collections: the R wrapper turns on `gctorture` so that every allocation
+triggers a collection, and each collection flags our unreachable weak
+reference key for finalization.  `R_alloc` use shows up as a change in
+`vmaxget`.
+
+@return integer(2), the number of the `reps` comparisons that allocated SEXPs
+  and the number that used `R_alloc`
+*/
+static SEXP ALIKEC_alloc_key;
+static int ALIKEC_alloc_hit;
+
+static void ALIKEC_alloc_fin(SEXP key) {
+  if(key == ALIKEC_alloc_key) ALIKEC_alloc_hit = 1;
+}
+SEXP ALIKEC_alloc_test(SEXP target, SEXP current, SEXP reps) {
+  int reps_int = asInteger(reps);
+  if(reps_int == NA_INTEGER || reps_int < 1) {
+    // nocov start
+    error("Internal Error: `reps` must be a positive integer");
+    // nocov end
+  }
+  struct VALC_settings set = VALC_settings_init();
+  int sexp_allocs = 0, r_allocs = 0;
+
+  for(int i = 0; i < reps_int; ++i) {
+    SEXP key = PROTECT(R_MakeExternalPtr(NULL, R_NilValue, R_NilValue));
+    SEXP wref =
+      PROTECT(R_MakeWeakRefC(key, R_NilValue, ALIKEC_alloc_fin, FALSE));
+    ALIKEC_alloc_key = key;
+    ALIKEC_alloc_hit = 0;
+    UNPROTECT(2);
+    PROTECT(wref);   // `key` is now only reachable through `wref`
+
+    const void * vmax = vmaxget();
+    if(!ALIKEC_alike_internal(target, current, set).success) {
+      // nocov start
+      error("Internal Error: `target` and `current` must be alike");
+      // nocov end
+    }
+    if(vmaxget() != vmax) ++r_allocs;
+    vmaxset(vmax);
+
+    R_RunPendingFinalizers();
+    if(ALIKEC_alloc_hit) ++sexp_allocs;
+    UNPROTECT(1);
+  }
+  ALIKEC_alloc_key = R_NilValue;
+
+  SEXP res = PROTECT(allocVector(INTSXP, 2));
+  INTEGER(res)[0] = sexp_allocs;
+  INTEGER(res)[1] = r_allocs;
+  UNPROTECT(1);
+  return res;
+}
@@ -126,7 +126,8 @@ See VALC_name_sub too.  We substitute `.` here as well, but logic before this fu
 Really seems like these two functions should be merged into one so that we don't get out of sync in how we use them.
 */
 SEXP VALC_sub_symbol(
-  SEXP lang, struct VALC_settings set, struct track_hash * track_hash
+  SEXP lang, struct VALC_settings set, struct track_hash * track_hash,
+  SEXP deps
 ) {
   size_t protect_i = 0;
   SEXP rho = set.env;
@@ -150,11 +151,15 @@ SEXP VALC_sub_symbol(
     if(findVar(lang, rho) != R_UnboundValue) {
       SEXP found_val = eval(lang, rho);
       SEXPTYPE found_val_type = TYPEOF(found_val);
+      VALC_parse_dep_add(deps, lang, found_val);
       if(found_val_type == LANGSXP || found_val_type == SYMSXP) {
         lang = PROTECT(duplicate(found_val));
       } else PROTECT(R_NilValue);  // Balance
       var_found_resolves_symbol = found_val_type == SYMSXP;
-    } else PROTECT(R_NilValue);  // Balance
+    } else {
+      VALC_parse_dep_add(deps, lang, R_NilValue);
+      PROTECT(R_NilValue);  // Balance
+    }
     protect_i = CSR_add_szt(protect_i, 1);
     if(!var_found_resolves_symbol) break;
   }
@@ -164,12 +169,18 @@ SEXP VALC_sub_symbol(
 SEXP VALC_sub_symbol_ext(SEXP lang, SEXP rho) {
   struct track_hash * track_hash = VALC_create_track_hash(64);
   struct VALC_settings set = VALC_settings_vet(R_NilValue, rho);
-  return VALC_sub_symbol(lang, set, track_hash);
+  return VALC_sub_symbol(lang, set, track_hash, R_NilValue);
 }
 /* -------------------------------------------------------------------------- *\
 \* -------------------------------------------------------------------------- */
 
-SEXP VALC_parse(SEXP lang, SEXP var_name, struct VALC_settings set) {
+/*
+ * @param deps R_NilValue, or a cons cell to record symbol lookups in for use
+ *   by the parse cache, see `VALC_parse_dep_add`
+ */
+SEXP VALC_parse(
+  SEXP lang, SEXP var_name, struct VALC_settings set, SEXP deps
+) {
   SEXP lang_cpy, res, res_vec, rem_res;
   int mode;
 
@@ -197,7 +208,8 @@ SEXP VALC_parse(SEXP lang, SEXP var_name, struct VALC_settings set) {
 
   if(lang_cpy == VALC_SYM_one_dot) mode = 2;
   lang_cpy = VALC_name_sub(lang_cpy, var_name);
-  if(mode != 2) lang_cpy = VALC_sub_symbol(lang_cpy, set, track_hash);
+  if(mode != 2)
+    lang_cpy = VALC_sub_symbol(lang_cpy, set, track_hash, deps);
 
   if(TYPEOF(lang_cpy) != LANGSXP) {
     res = PROTECT(ScalarInteger(mode ? 10 : 999));
@@ -205,7 +217,7 @@ SEXP VALC_parse(SEXP lang, SEXP var_name, struct VALC_settings set) {
     res = PROTECT(allocList(length(lang_cpy)));
     // lang_cpy, res, are modified internally
     VALC_parse_recurse(
-      lang_cpy, res, var_name, mode, R_NilValue, set, track_hash
+      lang_cpy, res, var_name, mode, R_NilValue, set, track_hash, deps
     );
   }
   res_vec = PROTECT(allocVector(VECSXP, 2));
@@ -216,14 +228,15 @@ SEXP VALC_parse(SEXP lang, SEXP var_name, struct VALC_settings set) {
 }
 SEXP VALC_parse_ext(SEXP lang, SEXP var_name, SEXP rho) {
   struct VALC_settings set = VALC_settings_vet(R_NilValue, rho);
-  return VALC_parse(lang, var_name, set);
+  return VALC_parse(lang, var_name, set, R_NilValue);
 }
 /* -------------------------------------------------------------------------- *\
 \* -------------------------------------------------------------------------- */
 
 void VALC_parse_recurse(
   SEXP lang, SEXP lang_track, SEXP var_name, int eval_as_is,
-  SEXP first_fun, struct VALC_settings set, struct track_hash * track_hash
+  SEXP first_fun, struct VALC_settings set, struct track_hash * track_hash,
+  SEXP deps
 ) {
   /*
   If the object is not a language list, then return it, as part of an R vector
@@ -300,7 +313,8 @@ void VALC_parse_recurse(
 
     int is_one_dot = (lang_car == VALC_SYM_one_dot);
     lang_car = PROTECT(VALC_name_sub(lang_car, var_name));
-    if(!is_one_dot) lang_car = VALC_sub_symbol(lang_car, set, track_hash);
+    if(!is_one_dot)
+      lang_car = VALC_sub_symbol(lang_car, set, track_hash, deps);
     UNPROTECT(1);
     SETCAR(lang, lang_car);
     UNPROTECT(1);
@@ -316,7 +330,7 @@ void VALC_parse_recurse(
       size_t substitute_level = track_hash->idx;
       VALC_parse_recurse(
         lang_car, CAR(lang_track), var_name, eval_as_is_internal,
-        first_fun, set, track_hash
+        first_fun, set, track_hash, deps
       );
       VALC_reset_track_hash(track_hash, substitute_level);
     } else {
@@ -0,0 +1,578 @@
+/*
+Copyright (C) 2017  Brodie Gaslam
+
+This file is part of "vetr - Trust, but Verify"
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
+*/
+
+/*
+Scanning kernels for plain atomic vector data.
+
+The `_dbl` and `_int` kernels work directly on data pointers and must not use
+the R API; they return the index of the first offending element, or -1.  The
+SEXP level functions at the end feed them either the data pointer or, for
+ALTREP objects that are not materialized, `SCAN_BLOCK` sized regions copied
+to the stack so we never force a compact or memory mapped vector into memory.
+Where ALTREP metadata (no NAs, sortedness) answers the question we don't scan
+at all.
+
+On x86 we use SSE2, which is always available on x86_64, and if the compiler
+supports it an AVX version chosen at run time.  Anything else gets the scalar
+version.  See DEVNOTES.md for benchmarks.
+
+Long plain vectors are split across threads with OpenMP when it is available,
+see `SCAN_chain_run`.
+*/
+
+#include "scan.h"
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+  (defined(__x86_64__) || defined(__i386__))
+#define SCAN_SSE2 1
+#include <emmintrin.h>
+#if defined(__clang__) || __GNUC__ >= 5
+#define SCAN_AVX 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 5, 0)
+#define SCAN_ALTREP 1
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#define SCAN_ATOMIC_READ _Pragma("omp atomic read")
+#define SCAN_ATOMIC_WRITE _Pragma("omp atomic write")
+#else
+#define SCAN_ATOMIC_READ
+#define SCAN_ATOMIC_WRITE
+#endif
+
+// Most threads we'll use for a scan
+
+#define SCAN_THREAD_MAX 128
+
+// Internal kernel id for integer likeness, see `SCAN_int_like`
+
+#define SCAN_KERN_INT_LIKE (SCAN_KERN_LT + 1)
+
+/*
+Integer like doubles
+--------------------
+
+An element is integer like if it is NA/NaN, or if it is in `int` range and has
+no fractional part.  The SIMD versions truncate to int32 and back and compare
+to the original; out of range values truncate to INT_MIN so only -2^31 itself
+survives the round trip, which the scalar version mimics (and avoids the
+undefined behavior of casting an out of range double to int).
+*/
+
+static int SCAN_not_int_like(double x) {
+  return !ISNAN(x) && (x < -2147483648.0 || x > 2147483647.0 || x != (int) x);
+}
+static R_xlen_t SCAN_int_like_dbl_scalar(const double * x, R_xlen_t n) {
+  for(R_xlen_t i = 0; i < n; ++i) if(SCAN_not_int_like(x[i])) return i;
+  return -1;
+}
+/*
+The SIMD versions only check for failure once per block, and if there is one
+re-scan the block with the scalar version to find the offending element
+*/
+#ifdef SCAN_SSE2
+static R_xlen_t SCAN_int_like_dbl_sse2(const double * x, R_xlen_t n) {
+  R_xlen_t i = 0, n2 = n - n % 2;
+
+  while(i < n2) {
+    R_xlen_t blk_start = i;
+    R_xlen_t blk_end = n2 - i > SCAN_BLOCK ? i + SCAN_BLOCK : n2;
+    __m128d bad = _mm_setzero_pd();
+    for(; i < blk_end; i += 2) {
+      __m128d v = _mm_loadu_pd(x + i);
+      __m128d r = _mm_cvtepi32_pd(_mm_cvttpd_epi32(v));
+      // `cmpneq` is true for NaN so mask those back out
+      bad = _mm_or_pd(
+        bad, _mm_andnot_pd(_mm_cmpunord_pd(v, v), _mm_cmpneq_pd(v, r))
+      );
+    }
+    if(_mm_movemask_pd(bad))
+      return blk_start +
+        SCAN_int_like_dbl_scalar(x + blk_start, blk_end - blk_start);
+  }
+  R_xlen_t tail = SCAN_int_like_dbl_scalar(x + n2, n - n2);
+  return tail < 0 ? tail : n2 + tail;
+}
+#endif
+#ifdef SCAN_AVX
+__attribute__((target("avx")))
+static R_xlen_t SCAN_int_like_dbl_avx(const double * x, R_xlen_t n) {
+  R_xlen_t i = 0, n4 = n - n % 4;
+
+  while(i < n4) {
+    R_xlen_t blk_start = i;
+    R_xlen_t blk_end = n4 - i > SCAN_BLOCK ? i + SCAN_BLOCK : n4;
+    __m256d bad = _mm256_setzero_pd();
+    for(; i < blk_end; i += 4) {
+      __m256d v = _mm256_loadu_pd(x + i);
+      __m256d r = _mm256_cvtepi32_pd(_mm256_cvttpd_epi32(v));
+      // ordered comparison is false for NaN
+      bad = _mm256_or_pd(bad, _mm256_cmp_pd(v, r, _CMP_NEQ_OQ));
+    }
+    if(_mm256_movemask_pd(bad))
+      return blk_start +
+        SCAN_int_like_dbl_scalar(x + blk_start, blk_end - blk_start);
+  }
+  R_xlen_t tail = SCAN_int_like_dbl_scalar(x + n4, n - n4);
+  return tail < 0 ? tail : n4 + tail;
+}
+#endif
+
+R_xlen_t SCAN_int_like_dbl(const double * x, R_xlen_t n) {
+#ifdef SCAN_AVX
+  if(__builtin_cpu_supports("avx")) return SCAN_int_like_dbl_avx(x, n);
+#endif
+#ifdef SCAN_SSE2
+  return SCAN_int_like_dbl_sse2(x, n);
+#else
+  return SCAN_int_like_dbl_scalar(x, n);
+#endif
+}
+/*
+Token kernels
+-------------
+
+Kernels for the element-wise vetting tokens, each returning the index of the
+first element for which the token would not be TRUE.  `c` is the constant
+operand for the comparison kernels and is ignored by the others.  They are
+branch free within each block so the compiler can vectorize them.
+
+Comparisons are written as `!(x op c)` so NaN values count as failures, as
+they would produce NA in R.
+*/
+
+#define SCAN_KERN_DBL(name, bad_expr) \
+static R_xlen_t SCAN_##name##_dbl(const double * x, R_xlen_t n, double c) { \
+  for(R_xlen_t i = 0; i < n; i += SCAN_BLOCK) { \
+    R_xlen_t end = n - i > SCAN_BLOCK ? i + SCAN_BLOCK : n; \
+    int bad = 0; \
+    for(R_xlen_t j = i; j < end; ++j) bad |= (bad_expr); \
+    if(bad) for(R_xlen_t j = i; j < end; ++j) if(bad_expr) return j; \
+  } \
+  return -1; \
+}
+#define SCAN_KERN_INT(name, bad_expr) \
+static R_xlen_t SCAN_##name##_int(const int * x, R_xlen_t n, double c) { \
+  for(R_xlen_t i = 0; i < n; i += SCAN_BLOCK) { \
+    R_xlen_t end = n - i > SCAN_BLOCK ? i + SCAN_BLOCK : n; \
+    int bad = 0; \
+    for(R_xlen_t j = i; j < end; ++j) bad |= (bad_expr); \
+    if(bad) for(R_xlen_t j = i; j < end; ++j) if(bad_expr) return j; \
+  } \
+  return -1; \
+}
+
+SCAN_KERN_DBL(na, ISNAN(x[j]))
+SCAN_KERN_DBL(not_finite, !isfinite(x[j]))
+SCAN_KERN_DBL(gte, !(x[j] >= c))
+SCAN_KERN_DBL(lte, !(x[j] <= c))
+SCAN_KERN_DBL(gt, !(x[j] > c))
+SCAN_KERN_DBL(lt, !(x[j] < c))
+
+SCAN_KERN_INT(na, x[j] == NA_INTEGER)
+SCAN_KERN_INT(gte, x[j] == NA_INTEGER || !((double) x[j] >= c))
+SCAN_KERN_INT(lte, x[j] == NA_INTEGER || !((double) x[j] <= c))
+SCAN_KERN_INT(gt, x[j] == NA_INTEGER || !((double) x[j] > c))
+SCAN_KERN_INT(lt, x[j] == NA_INTEGER || !((double) x[j] < c))
+
+typedef R_xlen_t (* SCAN_kern_dbl)(const double *, R_xlen_t, double);
+typedef R_xlen_t (* SCAN_kern_int)(const int *, R_xlen_t, double);
+
+/*
+SEXP level
+----------
+
+Apply a kernel to a REALSXP, or to an INTSXP/LGLSXP, without materializing
+ALTREP objects.
+*/
+
+static R_xlen_t SCAN_apply_dbl(SEXP x, SCAN_kern_dbl kern, double c) {
+  R_xlen_t n = XLENGTH(x);
+#ifdef SCAN_ALTREP
+  if(ALTREP(x) && !DATAPTR_OR_NULL(x)) {
+    double buf[SCAN_BLOCK];
+    for(R_xlen_t i = 0; i < n; i += SCAN_BLOCK) {
+      R_xlen_t got = REAL_GET_REGION(x, i, SCAN_BLOCK, buf);
+      R_xlen_t bad = kern(buf, got, c);
+      if(bad >= 0) return i + bad;
+    }
+    return -1;
+  }
+#endif
+  return kern(REAL(x), n, c);
+}
+static R_xlen_t SCAN_apply_int(SEXP x, SCAN_kern_int kern, double c) {
+  R_xlen_t n = XLENGTH(x);
+#ifdef SCAN_ALTREP
+  if(ALTREP(x) && !DATAPTR_OR_NULL(x)) {
+    int buf[SCAN_BLOCK];
+    for(R_xlen_t i = 0; i < n; i += SCAN_BLOCK) {
+      R_xlen_t got = TYPEOF(x) == LGLSXP ?
+        LOGICAL_GET_REGION(x, i, SCAN_BLOCK, buf) :
+        INTEGER_GET_REGION(x, i, SCAN_BLOCK, buf);
+      R_xlen_t bad = kern(buf, got, c);
+      if(bad >= 0) return i + bad;
+    }
+    return -1;
+  }
+#endif
+  return kern(TYPEOF(x) == LGLSXP ? LOGICAL(x) : INTEGER(x), n, c);
+}
+static R_xlen_t SCAN_int_like_dbl_c(const double * x, R_xlen_t n, double c) {
+  return SCAN_int_like_dbl(x, n);
+}
+/*
+ALTREP metadata
+---------------
+
+`SCAN_no_na` returns 1 if ALTREP metadata says `x` has no NAs.
+
+`SCAN_ends` is for sorted vectors without NAs where, for kernels that test
+for a range of values, the extremes tell us whether the kernel passes for all
+values.  It returns -1 if it can't tell,
+and otherwise the result of running the kernel on the extremes, adjusted so
+that it is a valid (if not necessarily first) failing index.  Since there are
+no NAs any failing index is as good as the first for our purposes.
+*/
+
+static int SCAN_no_na(SEXP x) {
+#ifdef SCAN_ALTREP
+  if(ALTREP(x)) {
+    switch(TYPEOF(x)) {
+      case LGLSXP: return LOGICAL_NO_NA(x);
+      case INTSXP: return INTEGER_NO_NA(x);
+      case REALSXP: return REAL_NO_NA(x);
+      case STRSXP: return STRING_NO_NA(x);
+  } }
+#endif
+  return 0;
+}
+static R_xlen_t SCAN_ends(
+  SEXP x, SCAN_kern_dbl kern_dbl, SCAN_kern_int kern_int, double c
+) {
+#ifdef SCAN_ALTREP
+  R_xlen_t n = XLENGTH(x);
+  if(!n || !ALTREP(x) || !SCAN_no_na(x)) return -2;
+
+  R_xlen_t bad;
+  if(TYPEOF(x) == REALSXP && kern_dbl && KNOWN_SORTED(REAL_IS_SORTED(x))) {
+    double ends[2] = {REAL_ELT(x, 0), REAL_ELT(x, n - 1)};
+    bad = kern_dbl(ends, 2, c);
+  } else if(
+    TYPEOF(x) == INTSXP && kern_int && KNOWN_SORTED(INTEGER_IS_SORTED(x))
+  ) {
+    int ends[2] = {INTEGER_ELT(x, 0), INTEGER_ELT(x, n - 1)};
+    bad = kern_int(ends, 2, c);
+  } else return -2;
+
+  return bad <= 0 ? bad : n - 1;
+#else
+  return -2;
+#endif
+}
+/*
+Index of the first element for which `kern` fails (-1 if none), or -2 if `x`
+is not of a type we handle
+*/
+static R_xlen_t SCAN_run(
+  SEXP x, SCAN_kern_dbl kern_dbl, SCAN_kern_int kern_int, double c
+) {
+  R_xlen_t bad = SCAN_ends(x, kern_dbl, kern_int, c);
+  if(bad >= -1) return bad;
+
+  switch(TYPEOF(x)) {
+    case LGLSXP:
+    case INTSXP:
+      if(kern_int) return SCAN_apply_int(x, kern_int, c);
+      break;
+    case REALSXP:
+      if(kern_dbl) return SCAN_apply_dbl(x, kern_dbl, c);
+  }
+  return -2;
+}
+/*
+First NA or non-finite element, mimicking `is.na` and `is.finite`; these also
+handle STRSXP (NA only) and CPLXSXP
+*/
+static R_xlen_t SCAN_na(SEXP x, int finite) {
+  if(!finite && SCAN_no_na(x)) return -1;
+  R_xlen_t n = XLENGTH(x);
+  switch(TYPEOF(x)) {
+    case STRSXP:
+      if(finite) return -2;
+      for(R_xlen_t i = 0; i < n; ++i)
+        if(STRING_ELT(x, i) == NA_STRING) return i;
+      return -1;
+    case CPLXSXP: {
+#ifdef SCAN_ALTREP
+      if(ALTREP(x)) return -2;
+#endif
+      Rcomplex * xc = COMPLEX(x);
+      for(R_xlen_t i = 0; i < n; ++i) {
+        if(
+          finite ? !isfinite(xc[i].r) || !isfinite(xc[i].i) :
+          ISNAN(xc[i].r) || ISNAN(xc[i].i)
+        )
+          return i;
+      }
+      return -1;
+    }
+  }
+  // for integers NA is the only non-finite value
+  return SCAN_run(
+    x, finite ? SCAN_not_finite_dbl : SCAN_na_dbl, SCAN_na_int, 0
+  );
+}
+static int SCAN_is_na_at(SEXP x, R_xlen_t i) {
+#ifdef SCAN_ALTREP
+  if(TYPEOF(x) == REALSXP) return ISNAN(REAL_ELT(x, i));
+  if(TYPEOF(x) == INTSXP) return INTEGER_ELT(x, i) == NA_INTEGER;
+  if(TYPEOF(x) == LGLSXP) return LOGICAL_ELT(x, i) == NA_LOGICAL;
+#else
+  if(TYPEOF(x) == REALSXP) return ISNAN(REAL(x)[i]);
+  if(TYPEOF(x) == INTSXP) return INTEGER(x)[i] == NA_INTEGER;
+  if(TYPEOF(x) == LGLSXP) return LOGICAL(x)[i] == NA_LOGICAL;
+#endif
+  return 0;
+}
+/*
+Kernels by `SCAN_KERN_*` id; for integers NA is the only non-finite value
+*/
+static const SCAN_kern_dbl SCAN_kerns_dbl[] = {
+  NULL, SCAN_na_dbl, SCAN_not_finite_dbl, SCAN_gte_dbl, SCAN_lte_dbl,
+  SCAN_gt_dbl, SCAN_lt_dbl, SCAN_int_like_dbl_c
+};
+static const SCAN_kern_int SCAN_kerns_int[] = {
+  NULL, SCAN_na_int, SCAN_na_int, SCAN_gte_int, SCAN_lte_int,
+  SCAN_gt_int, SCAN_lt_int, NULL
+};
+static void SCAN_kern_chk(int kern) {
+  if(kern < SCAN_KERN_NO_NA || kern > SCAN_KERN_LT) {
+    // nocov start
+    error("Internal Error: unknown kernel %d; contact maintainer.", kern);
+    // nocov end
+  }
+}
+/*
+Translate the first failing index from a kernel into the code `VALC_all`
+would return for the result of evaluating the token.  Only the comparison
+tokens produce NA for NA elements.
+*/
+static int SCAN_code(int kern, SEXP x, R_xlen_t bad) {
+  R_xlen_t n = XLENGTH(x);
+  if(!n) return -5;
+  if(bad < 0) return n == 1 ? 2 : 1;
+  if(kern >= SCAN_KERN_GTE && SCAN_is_na_at(x, bad)) return n == 1 ? -3 : -4;
+  return n == 1 ? -1 : 0;
+}
+/*
+Scan [start, end) running a chain of kernels, see `SCAN_chain_run`.
+
+Once a kernel fails the ones after it no longer matter so we stop running
+them, but we keep running the earlier ones since one of them may yet fail.
+With several segments scanned in parallel the same applies to the kernels
+other segments found failures for, except that for the failing kernel itself
+we still need to check whether we have an earlier failure unless the other
+segment comes before ours.  `seg_fail` holds the first failing kernel of each
+segment, and `seg_fail_at` the index of its first failure.
+*/
+static void SCAN_chain_seg(
+  const int * kerns, const double * cs, int n, const double * x_dbl,
+  const int * x_int, R_xlen_t start, R_xlen_t end, int seg, int n_seg,
+  int * seg_fail, R_xlen_t * seg_fail_at
+) {
+  int fail = n;
+  for(R_xlen_t i = start; i < end; i += SCAN_BLOCK) {
+    int cut = fail;
+    for(int s = 0; s < n_seg; ++s) {
+      if(s == seg) continue;
+      int s_fail;
+      SCAN_ATOMIC_READ
+      s_fail = seg_fail[s];
+      if(s > seg) ++s_fail;
+      if(s_fail < cut) cut = s_fail;
+    }
+    if(!cut) break;
+
+    R_xlen_t blk = end - i > SCAN_BLOCK ? SCAN_BLOCK : end - i;
+    for(int k = 0; k < cut; ++k) {
+      R_xlen_t bad = x_dbl ?
+        SCAN_kerns_dbl[kerns[k]](x_dbl + i, blk, cs[k]) :
+        SCAN_kerns_int[kerns[k]](x_int + i, blk, cs[k]);
+      if(bad >= 0) {
+        fail = k;
+        seg_fail_at[seg] = i + bad;
+        SCAN_ATOMIC_WRITE
+        seg_fail[seg] = k;
+        break;
+  } } }
+}
+/*
+Run a chain of kernels joined by `&&` in a single pass over `x`.
+
+We go through `x` one block at a time, running each kernel on the block
+while it is still in cache, so memory is only read once however long the
+chain.  Vectors with at least `par_min_len` elements (-1 to never) are split
+in as many contiguous segments as OpenMP gives us threads; each thread stops
+as soon as other threads' failures make its segment irrelevant.
+
+`x` must be a non-ALTREP integer, logical, or double vector.
+
+@return the index in `kerns` of the first failing kernel, with `* fail_at`
+  set to the index of the first element it failed for, or `n` if none fail
+*/
+static int SCAN_chain_run(
+  const int * kerns, const double * cs, int n, SEXP x, int par_min_len,
+  R_xlen_t * fail_at
+) {
+  SEXPTYPE type = TYPEOF(x);
+  R_xlen_t len = XLENGTH(x);
+  const double * x_dbl = type == REALSXP ? REAL(x) : NULL;
+  const int * x_int = type == REALSXP ? NULL :
+    (type == LGLSXP ? LOGICAL(x) : INTEGER(x));
+
+  int seg_fail[SCAN_THREAD_MAX];
+  R_xlen_t seg_fail_at[SCAN_THREAD_MAX];
+  int n_seg = 1;
+#ifdef _OPENMP
+  if(par_min_len >= 0 && len >= par_min_len) {
+    n_seg = omp_get_max_threads();
+    if(n_seg > SCAN_THREAD_MAX) n_seg = SCAN_THREAD_MAX;
+    if(n_seg > len / SCAN_BLOCK) n_seg = len / SCAN_BLOCK;
+    if(n_seg < 1) n_seg = 1;
+  }
+#endif
+  for(int s = 0; s < n_seg; ++s) seg_fail[s] = n;
+
+  if(n_seg > 1) {
+#ifdef _OPENMP
+    R_xlen_t seg_len = len / n_seg;
+    #pragma omp parallel for num_threads(n_seg) schedule(static, 1)
+    for(int s = 0; s < n_seg; ++s) {
+      SCAN_chain_seg(
+        kerns, cs, n, x_dbl, x_int, s * seg_len,
+        s == n_seg - 1 ? len : (s + 1) * seg_len, s, n_seg, seg_fail,
+        seg_fail_at
+      );
+    }
+#endif
+  } else {
+    SCAN_chain_seg(
+      kerns, cs, n, x_dbl, x_int, 0, len, 0, 1, seg_fail, seg_fail_at
+    );
+  }
+  // Earliest segment with the earliest failing kernel
+
+  int fail = n;
+  for(int s = 0; s < n_seg; ++s) {
+    if(seg_fail[s] < fail) {
+      fail = seg_fail[s];
+      * fail_at = seg_fail_at[s];
+  } }
+  return fail;
+}
+static int SCAN_chain_ok(SEXP x) {
+  SEXPTYPE type = TYPEOF(x);
+#ifdef SCAN_ALTREP
+  if(ALTREP(x)) return 0;
+#endif
+  return type == LGLSXP || type == INTSXP || type == REALSXP;
+}
+/*
+Whether a REALSXP is integer like, see above; integer like extremes don't mean
+the values in between are so we can only use `SCAN_ends` to fail early
+*/
+int SCAN_int_like(SEXP x, int par_min_len) {
+  if(SCAN_chain_ok(x)) {
+    int kern = SCAN_KERN_INT_LIKE;
+    double c = 0;
+    R_xlen_t fail_at;
+    return SCAN_chain_run(&kern, &c, 1, x, par_min_len, &fail_at);
+  }
+  if(SCAN_ends(x, SCAN_int_like_dbl_c, NULL, 0) >= 0) return 0;
+  return SCAN_apply_dbl(x, SCAN_int_like_dbl_c, 0) < 0;
+}
+/*
+Run one of the vetting token kernels (`SCAN_KERN_*`) on `x`.
+
+We only handle plain atomic vectors since objects could have methods for the
+functions the tokens call.  Returns the same code that `VALC_all` would for
+the result of evaluating the token, or `SCAN_KERN_NA` if the kernel does not
+apply to `x` and the token must be evaluated the normal way.
+
+@param c the constant operand for the comparison kernels
+@param par_min_len see `SCAN_chain_run`
+*/
+int SCAN_kern(int kern, SEXP x, double c, int par_min_len) {
+  SCAN_kern_chk(kern);
+  if(OBJECT(x)) return SCAN_KERN_NA;
+
+  // Everything below reads the length, so leave NULL, environments,
+  // functions, calls, etc. to the normal evaluation
+
+  switch(TYPEOF(x)) {
+    case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP: case STRSXP:
+    case RAWSXP: case VECSXP: break;
+    default: return SCAN_KERN_NA;
+  }
+  R_xlen_t bad = -1;
+  if(SCAN_chain_ok(x)) {
+    if(SCAN_chain_run(&kern, &c, 1, x, par_min_len, &bad) == 1) bad = -1;
+    return SCAN_code(kern, x, bad);
+  }
+  switch(kern) {
+    case SCAN_KERN_NO_NA: bad = SCAN_na(x, 0); break;
+    case SCAN_KERN_FINITE: bad = SCAN_na(x, 1); break;
+    default: bad = SCAN_run(x, SCAN_kerns_dbl[kern], SCAN_kerns_int[kern], c);
+  }
+  if(bad < -1) return SCAN_KERN_NA;
+  return SCAN_code(kern, x, bad);
+}
+/*
+Run a chain of kernels joined by `&&`, see `SCAN_chain_run`; other objects
+should use `SCAN_kern`.
+
+@param kerns the `SCAN_KERN_*` ids of the chain, in order
+@param cs the constant operand for each kernel
+@param n the number of kernels
+@param codes set to the `VALC_all` codes of the kernels that would be
+  evaluated, i.e. up to and including the first failing one
+@return how many elements of `codes` were set, 0 if `x` could not be handled
+*/
+int SCAN_kern_chain(
+  const int * kerns, const double * cs, int n, SEXP x, int par_min_len,
+  int * codes
+) {
+  if(OBJECT(x) || !SCAN_chain_ok(x)) return 0;
+  for(int k = 0; k < n; ++k) SCAN_kern_chk(kerns[k]);
+
+  R_xlen_t fail_at = -1;
+  int fail = SCAN_chain_run(kerns, cs, n, x, par_min_len, &fail_at);
+
+  // Zero length fails the first token
+
+  if(!XLENGTH(x)) fail = 0;
+  for(int k = 0; k < fail && k < n; ++k) codes[k] = SCAN_code(kerns[k], x, -1);
+  if(fail < n) codes[fail] = SCAN_code(kerns[fail], x, fail_at);
+  return fail < n ? fail + 1 : n;
+}
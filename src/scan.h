@@ -0,0 +1,52 @@
+/*
+Copyright (C) 2017  Brodie Gaslam
+
+This file is part of "vetr - Trust, but Verify"
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
+*/
+
+#include <R.h>
+#include <Rinternals.h>
+#include <Rversion.h>
+
+#ifndef _SCAN_H
+#define _SCAN_H
+
+  // Number of elements scanned between checks for early exit
+
+  #define SCAN_BLOCK 1024
+
+  // Vetting tokens we have kernels for, see `VALC_custom_kern` in compile.c
+
+  #define SCAN_KERN_NONE   0
+  #define SCAN_KERN_NO_NA  1    // !is.na(.)
+  #define SCAN_KERN_FINITE 2    // is.finite(.)
+  #define SCAN_KERN_GTE    3    // . >= c, comparisons must come last
+  #define SCAN_KERN_LTE    4    // . <= c
+  #define SCAN_KERN_GT     5    // . > c
+  #define SCAN_KERN_LT     6    // . < c
+
+  // Returned by `SCAN_kern` if the kernel doesn't apply to the object
+
+  #define SCAN_KERN_NA -1000
+
+  R_xlen_t SCAN_int_like_dbl(const double * x, R_xlen_t n);
+  int SCAN_int_like(SEXP x, int par_min_len);
+  int SCAN_kern(int kern, SEXP x, double c, int par_min_len);
+  int SCAN_kern_chain(
+    const int * kerns, const double * cs, int n, SEXP x, int par_min_len,
+    int * codes
+  );
+
+#endif
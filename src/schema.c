@@ -0,0 +1,554 @@
+/*
+Copyright (C) 2017  Brodie Gaslam
+
+This file is part of "vetr - Trust, but Verify"
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
+*/
+
+#include "validate.h"
+
+/*
+Template schemas, see `vet_schema`.
+
+A schema is the template pre-digested into a flat array of nodes, one per
+distinct sub-template.  Each node records the type, the length (zero matches
+any length), the attributes `alike` will check, and for lists the node of
+each element.  Nodes are hash-consed as they are built, so e.g. the hundreds
+of `numeric()` columns of a wide zero row data frame are all the same node.
+
+Attributes are reduced to what the default `attr.mode` checks:
+
+* class: the CHARSXPs of the class vector, compared by pointer to the tail of
+  the class of `current`
+* names, levels, character row.names: the CHARSXPs, with "" matching anything
+* integer row.names: only the zero length ones of zero row data frames
+* dim: the dimensions, with zero matching anything
+* other attributes: a child node for the value, or nothing at all if the value
+  is zero length
+
+Anything else (S4 objects, language, functions, environments, dimnames, tsp,
+etc.) becomes a fallback node that is checked with the normal `alike` code.
+
+The schema check can only confirm success.  CHARSXPs with different pointers
+can still be equal (e.g. different encodings), integers can match numeric
+templates, and so on, so if the schema check fails `ALIKEC_alike_internal`
+runs the normal check against the original template, which is also what
+produces the error message.
+
+The external pointer protected value is a VECSXP with the template and a
+RAWSXP with the schema data.  The schema data references SEXPs that are part
+of the template so it is only valid as long as the template is, and cannot
+survive serialization; deserialized schemas are rebuilt from the template the
+first time they are used.
+*/
+
+#define ALIKEC_SN_ANY 0        // NULL in a nested position
+#define ALIKEC_SN_OBJ 1
+#define ALIKEC_SN_FALLBACK 2
+
+#define ALIKEC_SA_CLASS 0
+#define ALIKEC_SA_CHR 1        // names, levels, character row.names
+#define ALIKEC_SA_ROWNAMES 2   // zero length integer row.names
+#define ALIKEC_SA_DIM 3
+#define ALIKEC_SA_OTHER 4
+
+struct ALIKEC_snode {
+  int kind;
+  int type;
+  R_xlen_t len;
+  int need_attr;     // template has attributes other than srcref
+  int attr_n;
+  R_xlen_t attr_off;
+  R_xlen_t kid_off;  // for lists, `len` node ids start here in `kids`
+  SEXP tpl;          // an instance of the template for this node
+};
+struct ALIKEC_sattr {
+  SEXP tag;
+  int kind;
+  int node;          // for ALIKEC_SA_OTHER
+  SEXP val;          // template attribute value
+};
+struct ALIKEC_schema {
+  int n_nodes;
+  int root;
+  R_xlen_t n_attrs;
+  R_xlen_t n_kids;
+  struct ALIKEC_snode * nodes;
+  struct ALIKEC_sattr * attrs;
+  int * kids;
+};
+/*
+State used while building the schema; all memory is `R_alloc`ed.
+*/
+struct ALIKEC_sbuild {
+  struct ALIKEC_snode * nodes;
+  size_t n_nodes, cap_nodes;
+  struct ALIKEC_sattr * attrs;
+  size_t n_attrs, cap_attrs;
+  int * kids;
+  size_t n_kids, cap_kids;
+  size_t * hashes;   // hash of each node
+  size_t cap_hashes;
+  int * table;       // node ids by hash, -1 if empty
+  size_t mask;
+};
+static void * ALIKEC_sgrow(void * dat, size_t n, size_t * cap, size_t size) {
+  if(n < * cap) return dat;
+  size_t cap_new = * cap ? * cap * 2 : 16;
+  while(cap_new <= n) cap_new *= 2;
+  void * dat_new = R_alloc(cap_new, size);
+  if(n) memcpy(dat_new, dat, n * size);
+  * cap = cap_new;
+  return dat_new;
+}
+/*-----------------------------------------------------------------------------\
+\-----------------------------------------------------------------------------*/
+/*
+Hash-consing
+*/
+static size_t ALIKEC_shash_mix(size_t h, uintptr_t x) {
+  return (h ^ (size_t) x) * (size_t) 1099511628211U;
+}
+static size_t ALIKEC_shash_vec(size_t h, SEXP x) {
+  R_xlen_t len = XLENGTH(x);
+  h = ALIKEC_shash_mix(h, (uintptr_t) len);
+  if(TYPEOF(x) == STRSXP) {
+    for(R_xlen_t i = 0; i < len; ++i)
+      h = ALIKEC_shash_mix(h, (uintptr_t) STRING_ELT(x, i) >> 4);
+  } else if(TYPEOF(x) == INTSXP) {
+    for(R_xlen_t i = 0; i < len; ++i)
+      h = ALIKEC_shash_mix(h, (uintptr_t) INTEGER(x)[i]);
+  }
+  return h;
+}
+/*
+Same length character vectors with the same CHARSXPs, or integer vectors with
+the same values
+*/
+static int ALIKEC_svec_same(SEXP a, SEXP b) {
+  if(a == b) return 1;
+  R_xlen_t len = XLENGTH(a);
+  if(TYPEOF(a) != TYPEOF(b) || len != XLENGTH(b)) return 0;
+  if(TYPEOF(a) == STRSXP) {
+    for(R_xlen_t i = 0; i < len; ++i)
+      if(STRING_ELT(a, i) != STRING_ELT(b, i)) return 0;
+  } else if(TYPEOF(a) == INTSXP) {
+    for(R_xlen_t i = 0; i < len; ++i)
+      if(INTEGER(a)[i] != INTEGER(b)[i]) return 0;
+  } else return 0;
+  return 1;
+}
+static size_t ALIKEC_shash(
+  struct ALIKEC_snode node, struct ALIKEC_sattr * attrs, int * kids
+) {
+  size_t h = 14695981039346656037U;
+  h = ALIKEC_shash_mix(h, (uintptr_t) node.kind);
+  h = ALIKEC_shash_mix(h, (uintptr_t) node.type);
+  h = ALIKEC_shash_mix(h, (uintptr_t) node.len);
+  if(node.kind == ALIKEC_SN_FALLBACK)
+    return ALIKEC_shash_mix(h, (uintptr_t) node.tpl >> 4);
+  for(int i = 0; i < node.attr_n; ++i) {
+    h = ALIKEC_shash_mix(h, (uintptr_t) attrs[i].tag >> 4);
+    h = ALIKEC_shash_mix(h, (uintptr_t) attrs[i].node);
+    if(attrs[i].kind != ALIKEC_SA_OTHER) h = ALIKEC_shash_vec(h, attrs[i].val);
+  }
+  if(node.type == VECSXP)
+    for(R_xlen_t i = 0; i < node.len; ++i)
+      h = ALIKEC_shash_mix(h, (uintptr_t) kids[i]);
+  return h;
+}
+static int ALIKEC_snode_same(
+  struct ALIKEC_sbuild * b, int id, struct ALIKEC_snode node,
+  struct ALIKEC_sattr * attrs, int * kids
+) {
+  struct ALIKEC_snode old = b->nodes[id];
+  if(
+    old.kind != node.kind || old.type != node.type || old.len != node.len ||
+    old.need_attr != node.need_attr || old.attr_n != node.attr_n
+  )
+    return 0;
+  if(node.kind == ALIKEC_SN_FALLBACK) return old.tpl == node.tpl;
+
+  struct ALIKEC_sattr * old_attrs = b->attrs + old.attr_off;
+  for(int i = 0; i < node.attr_n; ++i) {
+    if(
+      old_attrs[i].tag != attrs[i].tag || old_attrs[i].kind != attrs[i].kind ||
+      old_attrs[i].node != attrs[i].node ||
+      (
+        attrs[i].kind != ALIKEC_SA_OTHER &&
+        !ALIKEC_svec_same(old_attrs[i].val, attrs[i].val)
+      )
+    )
+      return 0;
+  }
+  if(node.type == VECSXP)
+    for(R_xlen_t i = 0; i < node.len; ++i)
+      if(b->kids[old.kid_off + i] != kids[i]) return 0;
+  return 1;
+}
+static void ALIKEC_stable_grow(struct ALIKEC_sbuild * b) {
+  size_t cap = b->mask + 1;
+  if(b->n_nodes * 2 < cap) return;
+  cap *= 2;
+  b->table = (int *) R_alloc(cap, sizeof(int));
+  b->mask = cap - 1;
+  for(size_t i = 0; i < cap; ++i) b->table[i] = -1;
+  for(size_t id = 0; id < b->n_nodes; ++id) {
+    size_t i = b->hashes[id] & b->mask;
+    while(b->table[i] >= 0) i = (i + 1) & b->mask;
+    b->table[i] = (int) id;
+  }
+}
+/*
+Return the id of the node if we already have an identical one, otherwise
+add it along with its attributes and children
+*/
+static int ALIKEC_snode_add(
+  struct ALIKEC_sbuild * b, struct ALIKEC_snode node,
+  struct ALIKEC_sattr * attrs, int * kids
+) {
+  size_t h = ALIKEC_shash(node, attrs, kids);
+  size_t i = h & b->mask;
+  for(; b->table[i] >= 0; i = (i + 1) & b->mask) {
+    int id = b->table[i];
+    if(b->hashes[id] == h && ALIKEC_snode_same(b, id, node, attrs, kids))
+      return id;
+  }
+  if(b->n_nodes >= INT_MAX)
+    error("Template too large to convert to a schema.");  // nocov
+
+  R_xlen_t n_kids = node.type == VECSXP ? node.len : 0;
+  b->attrs = ALIKEC_sgrow(
+    b->attrs, b->n_attrs + node.attr_n, &b->cap_attrs,
+    sizeof(struct ALIKEC_sattr)
+  );
+  b->kids = ALIKEC_sgrow(
+    b->kids, b->n_kids + n_kids, &b->cap_kids, sizeof(int)
+  );
+  if(node.attr_n)
+    memcpy(
+      b->attrs + b->n_attrs, attrs, node.attr_n * sizeof(struct ALIKEC_sattr)
+    );
+  if(n_kids) memcpy(b->kids + b->n_kids, kids, n_kids * sizeof(int));
+  node.attr_off = b->n_attrs;
+  node.kid_off = b->n_kids;
+  b->n_attrs += node.attr_n;
+  b->n_kids += n_kids;
+
+  b->nodes = ALIKEC_sgrow(
+    b->nodes, b->n_nodes, &b->cap_nodes, sizeof(struct ALIKEC_snode)
+  );
+  b->hashes = ALIKEC_sgrow(
+    b->hashes, b->n_nodes, &b->cap_hashes, sizeof(size_t)
+  );
+  int id = (int) b->n_nodes++;
+  b->nodes[id] = node;
+  b->hashes[id] = h;
+  b->table[i] = id;
+  ALIKEC_stable_grow(b);
+  return id;
+}
+/*-----------------------------------------------------------------------------\
+\-----------------------------------------------------------------------------*/
+/*
+Build the node for `x`, returns the node id
+*/
+static int ALIKEC_snode_build(struct ALIKEC_sbuild * b, SEXP x) {
+  struct ALIKEC_snode node = {
+    .kind = ALIKEC_SN_OBJ, .type = TYPEOF(x), .len = 0, .need_attr = 0,
+    .attr_n = 0, .attr_off = 0, .kid_off = 0, .tpl = x
+  };
+  struct ALIKEC_sattr * attrs = NULL;
+  int * kids = NULL;
+
+  if(x == R_NilValue) {
+    node.kind = ALIKEC_SN_ANY;
+    return ALIKEC_snode_add(b, node, attrs, kids);
+  }
+  int supported = 0;
+  switch(node.type) {
+    case LGLSXP: case INTSXP: case REALSXP: case CPLXSXP: case STRSXP:
+    case RAWSXP: case VECSXP:
+      supported = !IS_S4_OBJECT(x);
+  }
+  if(!supported) {
+    node.kind = ALIKEC_SN_FALLBACK;
+    return ALIKEC_snode_add(b, node, attrs, kids);
+  }
+  node.len = XLENGTH(x);
+
+  // - Attributes --------------------------------------------------------------
+
+  int attr_n = 0;
+  for(SEXP a = ATTRIB(x); a != R_NilValue; a = CDR(a)) ++attr_n;
+  if(attr_n) attrs = (struct ALIKEC_sattr *)
+    R_alloc(attr_n, sizeof(struct ALIKEC_sattr));
+
+  for(SEXP a = ATTRIB(x); a != R_NilValue; a = CDR(a)) {
+    SEXP tag = TAG(a), val = CAR(a);
+    SEXPTYPE val_type = TYPEOF(val);
+    int plain = ATTRIB(val) == R_NilValue, kind = -1, kid = -1;
+
+    if(tag == R_SrcrefSymbol) continue;
+    node.need_attr = 1;
+
+    if(tag == R_ClassSymbol) {
+      if(val_type == STRSXP && plain) kind = ALIKEC_SA_CLASS;
+    } else if(tag == R_NamesSymbol || tag == R_LevelsSymbol) {
+      if(val_type == STRSXP && plain) kind = ALIKEC_SA_CHR;
+    } else if(tag == R_RowNamesSymbol) {
+      if(val_type == STRSXP && plain) kind = ALIKEC_SA_CHR;
+      else if(val_type == INTSXP && plain && !XLENGTH(val))
+        kind = ALIKEC_SA_ROWNAMES;
+    } else if(tag == R_DimSymbol) {
+      if(val_type == INTSXP && plain) kind = ALIKEC_SA_DIM;
+    } else if(tag != R_DimNamesSymbol && tag != R_TspSymbol) {
+      // zero length attributes match anything so need no record
+      if(!xlength(val)) continue;
+      kind = ALIKEC_SA_OTHER;
+      kid = ALIKEC_snode_build(b, val);
+    }
+    if(kind < 0) {
+      node = (struct ALIKEC_snode) {
+        .kind = ALIKEC_SN_FALLBACK, .type = TYPEOF(x), .tpl = x
+      };
+      return ALIKEC_snode_add(b, node, NULL, NULL);
+    }
+    attrs[node.attr_n++] =
+      (struct ALIKEC_sattr) {.tag = tag, .kind = kind, .node = kid, .val = val};
+  }
+  // - List Elements -----------------------------------------------------------
+
+  if(node.type == VECSXP && node.len) {
+    kids = (int *) R_alloc(node.len, sizeof(int));
+    for(R_xlen_t i = 0; i < node.len; ++i)
+      kids[i] = ALIKEC_snode_build(b, VECTOR_ELT(x, i));
+  }
+  return ALIKEC_snode_add(b, node, attrs, kids);
+}
+#define ALIKEC_SALIGN(x) (((x) + 7) & ~((size_t) 7))
+
+/*
+Build the schema and copy it into a RAWSXP
+*/
+static SEXP ALIKEC_schema_build(SEXP template) {
+  struct ALIKEC_sbuild b = {
+    NULL, 0, 0, NULL, 0, 0, NULL, 0, 0, NULL, 0, NULL, 15
+  };
+  b.table = (int *) R_alloc(b.mask + 1, sizeof(int));
+  for(size_t i = 0; i <= b.mask; ++i) b.table[i] = -1;
+
+  int root = ALIKEC_snode_build(&b, template);
+
+  size_t off_nodes = ALIKEC_SALIGN(sizeof(struct ALIKEC_schema));
+  size_t off_attrs =
+    off_nodes + ALIKEC_SALIGN(b.n_nodes * sizeof(struct ALIKEC_snode));
+  size_t off_kids =
+    off_attrs + ALIKEC_SALIGN(b.n_attrs * sizeof(struct ALIKEC_sattr));
+  size_t size = off_kids + b.n_kids * sizeof(int);
+
+  SEXP raw = PROTECT(allocVector(RAWSXP, (R_xlen_t) size));
+  struct ALIKEC_schema * s = (struct ALIKEC_schema *) RAW(raw);
+  s->n_nodes = (int) b.n_nodes;
+  s->root = root;
+  s->n_attrs = b.n_attrs;
+  s->n_kids = b.n_kids;
+  memcpy(
+    RAW(raw) + off_nodes, b.nodes, b.n_nodes * sizeof(struct ALIKEC_snode)
+  );
+  if(b.n_attrs)
+    memcpy(
+      RAW(raw) + off_attrs, b.attrs, b.n_attrs * sizeof(struct ALIKEC_sattr)
+    );
+  if(b.n_kids) memcpy(RAW(raw) + off_kids, b.kids, b.n_kids * sizeof(int));
+  UNPROTECT(1);
+  return raw;
+}
+/*
+Point the array members of the schema to where they live in the RAWSXP; we
+do this on every retrieval since the RAWSXP is all we keep.
+*/
+static struct ALIKEC_schema * ALIKEC_schema_ptrs(SEXP raw) {
+  struct ALIKEC_schema * s = (struct ALIKEC_schema *) RAW(raw);
+  size_t off_nodes = ALIKEC_SALIGN(sizeof(struct ALIKEC_schema));
+  size_t off_attrs =
+    off_nodes + ALIKEC_SALIGN(s->n_nodes * sizeof(struct ALIKEC_snode));
+  size_t off_kids =
+    off_attrs + ALIKEC_SALIGN(s->n_attrs * sizeof(struct ALIKEC_sattr));
+  s->nodes = (struct ALIKEC_snode *) (RAW(raw) + off_nodes);
+  s->attrs = (struct ALIKEC_sattr *) (RAW(raw) + off_attrs);
+  s->kids = (int *) (RAW(raw) + off_kids);
+  return s;
+}
+SEXP ALIKEC_schema_ext(SEXP template) {
+  // the schema references the template so it must never change
+
+  VALC_not_mutable(template);
+  SEXP dat = PROTECT(allocVector(VECSXP, 2));
+  SET_VECTOR_ELT(dat, 0, template);
+  SET_VECTOR_ELT(dat, 1, ALIKEC_schema_build(template));
+  SEXP res = R_MakeExternalPtr(
+    ALIKEC_schema_ptrs(VECTOR_ELT(dat, 1)), ALIKEC_SYM_schema, dat
+  );
+  UNPROTECT(1);
+  return res;
+}
+int ALIKEC_is_schema(SEXP x) {
+  return TYPEOF(x) == EXTPTRSXP && R_ExternalPtrTag(x) == ALIKEC_SYM_schema;
+}
+SEXP ALIKEC_schema_template(SEXP schema) {
+  SEXP dat = R_ExternalPtrProtected(schema);
+  if(TYPEOF(dat) != VECSXP || XLENGTH(dat) != 2)
+    error("Corrupted vetr schema.");
+  return VECTOR_ELT(dat, 0);
+}
+/*
+Retrieve the schema, rebuilding it if it was serialized
+*/
+static struct ALIKEC_schema * ALIKEC_schema_get(SEXP schema) {
+  struct ALIKEC_schema * s = R_ExternalPtrAddr(schema);
+  if(!s) {
+    SEXP dat = R_ExternalPtrProtected(schema);
+    SEXP template = ALIKEC_schema_template(schema);
+    VALC_not_mutable(template);
+    SET_VECTOR_ELT(dat, 1, ALIKEC_schema_build(template));
+    s = ALIKEC_schema_ptrs(VECTOR_ELT(dat, 1));
+    R_SetExternalPtrAddr(schema, s);
+  }
+  return s;
+}
+/*-----------------------------------------------------------------------------\
+\-----------------------------------------------------------------------------*/
+/*
+Whether the character vector `cur` matches the one from the template like
+`ALIKEC_compare_special_char_attrs_internal` would require
+*/
+static int ALIKEC_schema_chr(SEXP tar, SEXP cur) {
+  if(TYPEOF(cur) != STRSXP || ATTRIB(cur) != R_NilValue) return 0;
+  R_xlen_t len = XLENGTH(tar);
+  if(!len) return 1;
+  if(len != XLENGTH(cur)) return 0;
+  for(R_xlen_t i = 0; i < len; ++i) {
+    SEXP tar_chr = STRING_ELT(tar, i);
+    if(tar_chr != R_BlankString && tar_chr != STRING_ELT(cur, i)) return 0;
+  }
+  return 1;
+}
+static int ALIKEC_schema_rec(
+  struct ALIKEC_schema * s, int id, SEXP cur, struct VALC_settings set
+);
+
+static int ALIKEC_schema_attr(
+  struct ALIKEC_schema * s, struct ALIKEC_sattr * attr, SEXP cur_attr,
+  struct VALC_settings set
+) {
+  SEXP cur = R_NilValue;
+  for(; cur_attr != R_NilValue; cur_attr = CDR(cur_attr)) {
+    if(TAG(cur_attr) == attr->tag) {
+      cur = CAR(cur_attr);
+      break;
+  } }
+  if(cur == R_NilValue) return 0;
+  SEXP tar = attr->val;
+
+  switch(attr->kind) {
+    case ALIKEC_SA_CLASS: {
+      if(TYPEOF(cur) != STRSXP || ATTRIB(cur) != R_NilValue) return 0;
+      R_xlen_t tar_len = XLENGTH(tar), cur_len = XLENGTH(cur);
+      if(cur_len < tar_len) return 0;
+      for(R_xlen_t i = 0; i < tar_len; ++i)
+        if(STRING_ELT(tar, i) != STRING_ELT(cur, cur_len - tar_len + i))
+          return 0;
+      return 1;
+    }
+    case ALIKEC_SA_CHR:
+      return ALIKEC_schema_chr(tar, cur);
+    case ALIKEC_SA_ROWNAMES:
+      return TYPEOF(cur) == INTSXP && ATTRIB(cur) == R_NilValue;
+    case ALIKEC_SA_DIM: {
+      R_xlen_t len = XLENGTH(tar);
+      if(
+        TYPEOF(cur) != INTSXP || ATTRIB(cur) != R_NilValue ||
+        XLENGTH(cur) != len
+      )
+        return 0;
+      for(R_xlen_t i = 0; i < len; ++i)
+        if(INTEGER(tar)[i] && INTEGER(tar)[i] != INTEGER(cur)[i]) return 0;
+      return 1;
+    }
+    case ALIKEC_SA_OTHER:
+      // `alike` on attributes doesn't recurse into environments
+      set.in_attr++;
+      return TYPEOF(cur) == TYPEOF(tar) && xlength(cur) == xlength(tar) &&
+        ALIKEC_schema_rec(s, attr->node, cur, set);
+  }
+  // nocov start
+  error("Internal Error: unknown schema attribute; contact maintainer.");
+  return 0;
+  // nocov end
+}
+static int ALIKEC_schema_rec(
+  struct ALIKEC_schema * s, int id, SEXP cur, struct VALC_settings set
+) {
+  struct ALIKEC_snode * node = s->nodes + id;
+
+  switch(node->kind) {
+    case ALIKEC_SN_ANY: return 1;
+    case ALIKEC_SN_FALLBACK:
+      return ALIKEC_alike_rec(node->tpl, cur, ALIKEC_rec_def(), set).success;
+  }
+  // - Type --------------------------------------------------------------------
+
+  SEXPTYPE cur_type = TYPEOF(cur);
+  if(IS_S4_OBJECT(cur)) return 0;
+  if(cur_type != node->type) {
+    if(!(cur_type == INTSXP && node->type == REALSXP && set.type_mode < 2))
+      return 0;
+  }
+  // - Length ------------------------------------------------------------------
+
+  R_xlen_t cur_len = XLENGTH(cur);
+  if(node->len && node->len != cur_len) return 0;
+
+  // - Attributes --------------------------------------------------------------
+
+  SEXP cur_attr = ATTRIB(cur);
+  if(node->need_attr && cur_attr == R_NilValue) return 0;
+  for(int i = 0; i < node->attr_n; ++i)
+    if(!ALIKEC_schema_attr(s, s->attrs + node->attr_off + i, cur_attr, set))
+      return 0;
+
+  // - List Elements -----------------------------------------------------------
+
+  if(node->type == VECSXP) {
+    int * kids = s->kids + node->kid_off;
+    for(R_xlen_t i = 0; i < node->len; ++i)
+      if(!ALIKEC_schema_rec(s, kids[i], VECTOR_ELT(cur, i), set)) return 0;
+  }
+  return 1;
+}
+/*
+Whether `current` is certainly alike the schema's template; only meaningful
+with the default `attr.mode`.
+*/
+int ALIKEC_schema_alike(SEXP schema, SEXP current, struct VALC_settings set) {
+  if(set.attr_mode) return 0;
+  struct ALIKEC_schema * s = ALIKEC_schema_get(schema);
+
+  // Top level NULL templates are handled specially by `alike`, and there is
+  // no point in falling back only to fall back again if we fail
+
+  if(s->nodes[s->root].kind != ALIKEC_SN_OBJ) return 0;
+  return ALIKEC_schema_rec(s, s->root, current, set);
+}
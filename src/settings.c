@@ -18,6 +18,48 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 
 #include "settings.h"
 #include <stdint.h>
+#include <string.h>
+
+/*
+ * Positions of the settings in the list produced by `vetr_settings`, which
+ * must match `VALC_set_names`
+ */
+#define VALC_SET_TYPE_MODE 0
+#define VALC_SET_ATTR_MODE 1
+#define VALC_SET_LANG_MODE 2
+#define VALC_SET_FUN_MODE 3
+#define VALC_SET_REC_MODE 4
+#define VALC_SET_SUP_WARN 5
+#define VALC_SET_FUZZY_INT 6
+#define VALC_SET_PAR_MIN 7
+#define VALC_SET_CHUNK 8
+#define VALC_SET_WIDTH 9
+#define VALC_SET_ENV_DEPTH 10
+#define VALC_SET_SUB_DEPTH 11
+#define VALC_SET_SYMB_SIZE 12
+#define VALC_SET_NCHAR 13
+#define VALC_SET_HASH_SIZE 14
+#define VALC_SET_ENV 15
+#define VALC_SET_LEN 16
+
+static const char * VALC_set_names[VALC_SET_LEN] = {
+  [VALC_SET_TYPE_MODE] = "type.mode",
+  [VALC_SET_ATTR_MODE] = "attr.mode",
+  [VALC_SET_LANG_MODE] = "lang.mode",
+  [VALC_SET_FUN_MODE] = "fun.mode",
+  [VALC_SET_REC_MODE] = "rec.mode",
+  [VALC_SET_SUP_WARN] = "suppress.warnings",
+  [VALC_SET_FUZZY_INT] = "fuzzy.int.max.len",
+  [VALC_SET_PAR_MIN] = "par.min.len",
+  [VALC_SET_CHUNK] = "chunk.len",
+  [VALC_SET_WIDTH] = "width",
+  [VALC_SET_ENV_DEPTH] = "env.depth.max",
+  [VALC_SET_SUB_DEPTH] = "symb.sub.depth.max",
+  [VALC_SET_SYMB_SIZE] = "symb.size.max",
+  [VALC_SET_NCHAR] = "nchar.max",
+  [VALC_SET_HASH_SIZE] = "track.hash.content.size",
+  [VALC_SET_ENV] = "env"
+};
 
 /*
  * Initialize settings with default values
@@ -28,9 +70,12 @@ struct VALC_settings VALC_settings_init() {
     .attr_mode = 0,
     .lang_mode = 0,
     .fun_mode = 0,
-    .fuzzy_int_max_len = 100,
+    .fuzzy_int_max_len = 1000000,
+    .par_min_len = 10000000,
+    .chunk_len = 1000000,
     .suppress_warnings = 0,
     .in_attr = 0,
+    .no_msg = 0,
     .env = R_NilValue,
     .width = -1,
     .env_depth_max = 65535L,
@@ -74,6 +119,11 @@ static long VALC_is_scalar_int(
     );
   return x_int;
 }
+static long VALC_set_int(SEXP set_list, int i, int x_min, int x_max) {
+  return VALC_is_scalar_int(
+    VECTOR_ELT(set_list, i), VALC_set_names[i], x_min, x_max
+  );
+}
 /*
  * Convert input setting list into settings structure, validating
  * along the way
@@ -82,11 +132,20 @@ static long VALC_is_scalar_int(
  * it is fastest this way
  */
 
+static struct VALC_settings * VALC_settings_get(SEXP settings);
+
 struct VALC_settings VALC_settings_vet(SEXP set_list, SEXP env) {
   struct VALC_settings settings = VALC_settings_init();
-  R_xlen_t set_len = 14;
+  R_xlen_t set_len = VALC_SET_LEN;
 
-  if(TYPEOF(set_list) == VECSXP) {
+  if(
+    TYPEOF(set_list) == EXTPTRSXP &&
+    R_ExternalPtrTag(set_list) == VALC_SYM_settings
+  ) {
+    // Already validated by `VALC_settings_compile`
+
+    settings = * VALC_settings_get(set_list);
+  } else if(TYPEOF(set_list) == VECSXP) {
     if(xlength(set_list) != set_len) {
       error(
         "`vet/vetr` usage error: `settings` must be a list of length %zu.",
@@ -101,15 +160,9 @@ struct VALC_settings VALC_settings_vet(SEXP set_list, SEXP env) {
         "by `vetr_settings`."
       );
     }
-    const char * set_names_default[] = {
-      "type.mode", "attr.mode", "lang.mode", "fun.mode", "rec.mode",
-      "suppress.warnings", "fuzzy.int.max.len",
-      "width", "env.depth.max", "symb.sub.depth.max", "symb.size.max",
-      "nchar.max", "track.hash.content.size", "env"
-    };
     SEXP set_names_def_sxp = PROTECT(allocVector(STRSXP, set_len));
     for(R_xlen_t i = 0; i < set_len; ++i) {
-      SET_STRING_ELT(set_names_def_sxp, i, mkChar(set_names_default[i]));
+      SET_STRING_ELT(set_names_def_sxp, i, mkChar(VALC_set_names[i]));
     }
     if(!R_compute_identical(set_names, set_names_def_sxp, 16)) {
       error(
@@ -122,37 +175,29 @@ struct VALC_settings VALC_settings_vet(SEXP set_list, SEXP env) {
     UNPROTECT(1);
     // check the scalar integers
 
-    settings.type_mode =
-      VALC_is_scalar_int(VECTOR_ELT(set_list, 0), "type.mode", 0, 2);
-    settings.attr_mode =
-      VALC_is_scalar_int(VECTOR_ELT(set_list, 1), "attr.mode", 0, 2);
-    settings.lang_mode =
-      VALC_is_scalar_int(VECTOR_ELT(set_list, 2), "lang.mode", 0, 2);
-    settings.fun_mode =
-      VALC_is_scalar_int(VECTOR_ELT(set_list, 3), "fun.mode", 0, 2);
-    settings.rec_mode =
-      VALC_is_scalar_int(VECTOR_ELT(set_list, 4), "rec.mode", 0, 2);
-    settings.fuzzy_int_max_len = VALC_is_scalar_int(
-      VECTOR_ELT(set_list, 6), "fuzzy.int.max.len", INT_MIN, INT_MAX
-    );
-    settings.width =
-      VALC_is_scalar_int(VECTOR_ELT(set_list, 7), "width", -1, INT_MAX);
+    settings.type_mode = VALC_set_int(set_list, VALC_SET_TYPE_MODE, 0, 2);
+    settings.attr_mode = VALC_set_int(set_list, VALC_SET_ATTR_MODE, 0, 2);
+    settings.lang_mode = VALC_set_int(set_list, VALC_SET_LANG_MODE, 0, 2);
+    settings.fun_mode = VALC_set_int(set_list, VALC_SET_FUN_MODE, 0, 2);
+    settings.rec_mode = VALC_set_int(set_list, VALC_SET_REC_MODE, 0, 2);
+    settings.fuzzy_int_max_len =
+      VALC_set_int(set_list, VALC_SET_FUZZY_INT, INT_MIN, INT_MAX);
+    settings.par_min_len =
+      VALC_set_int(set_list, VALC_SET_PAR_MIN, -1, INT_MAX);
+    settings.chunk_len = VALC_set_int(set_list, VALC_SET_CHUNK, -1, INT_MAX);
+    settings.width = VALC_set_int(set_list, VALC_SET_WIDTH, -1, INT_MAX);
     settings.env_depth_max =
-      VALC_is_scalar_int(VECTOR_ELT(set_list, 8), "env.depth.max", -1, INT_MAX);
-    settings.symb_sub_depth_max = VALC_is_scalar_int(
-      VECTOR_ELT(set_list, 9), "symb.sub.depth.max", 0, INT_MAX
-    );
-    settings.nchar_max =
-      VALC_is_scalar_int(VECTOR_ELT(set_list, 10), "nchar.max", 0, INT_MAX);
-    settings.symb_size_max = VALC_is_scalar_int(
-      VECTOR_ELT(set_list, 11), "symb.size.max", 0, INT_MAX
-    );
-    settings.track_hash_content_size = VALC_is_scalar_int(
-      VECTOR_ELT(set_list, 12), "track.hash.content.size", 0, INT_MAX
-    );
+      VALC_set_int(set_list, VALC_SET_ENV_DEPTH, -1, INT_MAX);
+    settings.symb_sub_depth_max =
+      VALC_set_int(set_list, VALC_SET_SUB_DEPTH, 0, INT_MAX);
+    settings.nchar_max = VALC_set_int(set_list, VALC_SET_NCHAR, 0, INT_MAX);
+    settings.symb_size_max =
+      VALC_set_int(set_list, VALC_SET_SYMB_SIZE, 0, INT_MAX);
+    settings.track_hash_content_size =
+      VALC_set_int(set_list, VALC_SET_HASH_SIZE, 0, INT_MAX);
     // Other checks
 
-    SEXP sup_warn = VECTOR_ELT(set_list, 5);
+    SEXP sup_warn = VECTOR_ELT(set_list, VALC_SET_SUP_WARN);
     if(
       TYPEOF(sup_warn) != LGLSXP || xlength(sup_warn) != 1 ||
       asInteger(sup_warn) == NA_LOGICAL
@@ -165,17 +210,15 @@ struct VALC_settings VALC_settings_vet(SEXP set_list, SEXP env) {
     }
     settings.suppress_warnings = asLogical(sup_warn);
 
-    if(
-      TYPEOF(VECTOR_ELT(set_list, 13)) != ENVSXP &&
-      VECTOR_ELT(set_list, 13) != R_NilValue
-    ) {
+    SEXP set_env = VECTOR_ELT(set_list, VALC_SET_ENV);
+    if(TYPEOF(set_env) != ENVSXP && set_env != R_NilValue) {
       error(
         "%s%s",
         "`ver/vetr` usage error: setting `env` must be an environment ",
         "or NULL"
       );
     }
-    settings.env = VECTOR_ELT(set_list, 13);
+    settings.env = set_env;
   } else if (set_list != R_NilValue) {
     error(
       "%s (is %s).",
@@ -189,3 +232,73 @@ struct VALC_settings VALC_settings_vet(SEXP set_list, SEXP env) {
   if(settings.env == R_NilValue) settings.env = env;
   return settings;
 }
+/*
+ * Compiled settings
+ *
+ * Validate a settings list once and store the resulting struct so that it can
+ * be used without re-validation on each call.  The result is an external
+ * pointer to the data of a RAWSXP containing the struct.  The protected value
+ * is a VECSXP with the original list and the RAWSXP; since the list contains
+ * `env` this also keeps the environment referenced in the struct alive.
+ */
+SEXP VALC_settings_compile(SEXP set_list) {
+  if(TYPEOF(set_list) != VECSXP)
+    // nocov start
+    error("Internal Error: settings must be a list; contact maintainer.");
+    // nocov end
+
+  // Any environment will do as `env` is replaced with whatever is in the list
+
+  struct VALC_settings set = VALC_settings_vet(set_list, R_BaseEnv);
+  set.env = VECTOR_ELT(set_list, VALC_SET_ENV);
+
+  SEXP set_raw = PROTECT(allocVector(RAWSXP, sizeof(struct VALC_settings)));
+  memcpy(RAW(set_raw), &set, sizeof(struct VALC_settings));
+
+  SEXP set_dat = PROTECT(allocVector(VECSXP, 2));
+  SET_VECTOR_ELT(set_dat, 0, set_list);
+  SET_VECTOR_ELT(set_dat, 1, set_raw);
+
+  SEXP res = PROTECT(
+    R_MakeExternalPtr(RAW(set_raw), VALC_SYM_settings, set_dat)
+  );
+  setAttrib(res, R_ClassSymbol, mkString("vetr_settings"));
+  UNPROTECT(3);
+  return res;
+}
+/*
+ * Serialized external pointers come back with a NULL address, in which case we
+ * re-validate the settings from the original list.
+ */
+static struct VALC_settings * VALC_settings_get(SEXP settings) {
+  struct VALC_settings * set = R_ExternalPtrAddr(settings);
+  if(!set) {
+    SEXP set_dat = R_ExternalPtrProtected(settings);
+    if(
+      TYPEOF(set_dat) != VECSXP || XLENGTH(set_dat) != 2 ||
+      TYPEOF(VECTOR_ELT(set_dat, 1)) != RAWSXP ||
+      XLENGTH(VECTOR_ELT(set_dat, 1)) != sizeof(struct VALC_settings)
+    )
+      error("Corrupted vetr settings.");
+
+    SEXP set_list = VECTOR_ELT(set_dat, 0);
+    struct VALC_settings set_new = VALC_settings_vet(set_list, R_BaseEnv);
+    set_new.env = VECTOR_ELT(set_list, VALC_SET_ENV);
+
+    set = (struct VALC_settings *) RAW(VECTOR_ELT(set_dat, 1));
+    memcpy(set, &set_new, sizeof(struct VALC_settings));
+    R_SetExternalPtrAddr(settings, set);
+  }
+  return set;
+}
+/*
+ * Recover the list compiled settings were created from
+ */
+SEXP VALC_settings_as_list(SEXP settings) {
+  if(
+    TYPEOF(settings) != EXTPTRSXP ||
+    R_ExternalPtrTag(settings) != VALC_SYM_settings
+  )
+    error("Argument `x` is not a \"vetr_settings\" object.");
+  return duplicate(VECTOR_ELT(R_ExternalPtrProtected(settings), 0));
+}
@@ -33,12 +33,27 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
 
     int fuzzy_int_max_len;
 
+    // Length of vectors from which value checks use multiple threads, -1 for
+    // never
+
+    int par_min_len;
+
+    // Length of the slices element-wise custom tokens are evaluated on, -1 to
+    // evaluate them on the whole object
+
+    int chunk_len;
+
     int suppress_warnings;
 
     // internal, track whether we are recursing through attributes
 
     int in_attr;
 
+    // internal, only report whether objects are alike / vetting passes and
+    // skip constructing messages
+
+    int no_msg;
+
     int width;      // Tell alike what screen width to assume
 
     // what env to look for functions to match call in, substitute, etc, used
@@ -56,5 +71,11 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
   };
   struct VALC_settings VALC_settings_init();
   struct VALC_settings VALC_settings_vet(SEXP set_list, SEXP env);
+  SEXP VALC_settings_compile(SEXP set_list);
+  SEXP VALC_settings_as_list(SEXP settings);
+
+  // Tag for compiled settings external pointers
+
+  SEXP VALC_SYM_settings;
 
 #endif
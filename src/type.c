@@ -58,8 +58,8 @@ struct ALIKEC_res_fin ALIKEC_type_alike_internal(
         tar_type_raw == BUILTINSXP
       )
     ) {
-      tar_type = ALIKEC_typeof_internal(target);
-      cur_type = ALIKEC_typeof_internal(current);
+      tar_type = ALIKEC_typeof_internal(target, set.par_min_len);
+      cur_type = ALIKEC_typeof_internal(current, set.par_min_len);
     }
   }
   if(tar_type == cur_type) return res;
@@ -69,6 +69,12 @@ struct ALIKEC_res_fin ALIKEC_type_alike_internal(
   ) {
     return res;
   }
+  // Callers only check that `target` is not empty
+
+  if(set.no_msg) {
+    res.target = "type";
+    return res;
+  }
   // This is slow, so we only compute it if we definitely need it (~100us)
 
   res.call = ALIKEC_pad_or_quote(call, set.width, -1, set);
@@ -111,26 +117,13 @@ SEXP ALIKEC_type_alike(
 
 /* - typeof ----------------------------------------------------------------- */
 
-SEXPTYPE ALIKEC_typeof_internal(SEXP object) {
-  double * obj_real;
+SEXPTYPE ALIKEC_typeof_internal(SEXP object, int par_min_len) {
   SEXPTYPE obj_type = TYPEOF(object);
 
   switch(obj_type) {
     case REALSXP:
-      {
-        R_xlen_t obj_len = XLENGTH(object), i;
-        obj_real = REAL(object);
-        /*
-        could optimize this more by using the magic number tricks or bit
-        fiddling, but at end of day this still wouldn't be fast enough to
-        realistically use on a very large vector, so it doesn't really matter
-        */
-        for(i = 0; i < obj_len; i++)
-          if(!isnan(obj_real[i]) && obj_real[i] != (int)obj_real[i])
-            return REALSXP;
-        return INTSXP;
-      }
-      break;
+      // see scan.c; does not materialize ALTREP objects
+      return SCAN_int_like(object, par_min_len) ? INTSXP : REALSXP;
     case CLOSXP:
     case BUILTINSXP:
     case SPECIALSXP:
@@ -144,5 +137,6 @@ SEXP return in the internal use case
 */
 
 SEXP ALIKEC_typeof(SEXP object) {
-  return mkString(type2char(ALIKEC_typeof_internal(object)));
+  struct VALC_settings set = VALC_settings_init();
+  return mkString(type2char(ALIKEC_typeof_internal(object, set.par_min_len)));
 }
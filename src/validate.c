@@ -197,6 +197,14 @@ SEXP VALC_validate(
 ) {
   SEXP res;
   struct VALC_settings set = VALC_settings_vet(settings, rho);
+
+  // In logical mode we never need messages unless we're going to stop
+
+  set.no_msg =
+    TYPEOF(ret_mode_sxp) == STRSXP && XLENGTH(ret_mode_sxp) == 1 &&
+    !strcmp(CHAR(STRING_ELT(ret_mode_sxp, 0)), "logical") &&
+    TYPEOF(stop) == LGLSXP && XLENGTH(stop) == 1 && !asLogical(stop);
+
   res = PROTECT(
     VALC_evaluate(
       target, cur_sub, VALC_SYM_current, current, par_call, set
@@ -204,7 +212,11 @@ SEXP VALC_validate(
   );
   if(IS_TRUE(res)) {
     UNPROTECT(1);
-    return(ScalarLogical(1));
+    return(VALC_TRUE);
+  }
+  if(set.no_msg) {
+    UNPROTECT(1);
+    return(ScalarLogical(0));
   }
   if(TYPEOF(ret_mode_sxp) != STRSXP && XLENGTH(ret_mode_sxp) != 1)
     error("`vet` usage error: argument `format` must be character(1L)");
@@ -225,11 +237,13 @@ SEXP VALC_validate(
     ret_mode = 2;
   } else if(!strcmp(ret_mode_chr, "full")) {
     ret_mode = 1;
+  } else if(!strcmp(ret_mode_chr, "logical")) {
+    ret_mode = 1;   // only get here if `stop` is TRUE
   } else
     error(
       "%s%s",
       "`vet` usage error: argument `format` must be one of \"text\", \"raw\", ",
-      "\"full\""
+      "\"full\", \"logical\""
     );
 
   SEXP out = VALC_process_error(
@@ -242,77 +256,65 @@ SEXP VALC_validate(
 /* -------------------------------------------------------------------------- *\
 \* -------------------------------------------------------------------------- */
 
+/*
+ * Reconstruct the matched function call.
+ *
+ * This is only needed for error messages so we avoid it unless something
+ * failed.  Evaluating `match.call()` in the function frame is equivalent to
+ * calling it from the function body.
+ */
+static SEXP VALC_fun_call(SEXP fun_frame) {
+  SEXP match_call = PROTECT(lang1(ALIKEC_SYM_matchcall));
+  SEXP res = eval(match_call, fun_frame);
+  UNPROTECT(1);
+  return res;
+}
+/*
+ * Retrieve the expression corresponding to a formal from the matched function
+ * call, or its default value if it was not specified.
+ */
+static SEXP VALC_fun_tok(SEXP fun_call, SEXP fun_form) {
+  for(SEXP args = CDR(fun_call); args != R_NilValue; args = CDR(args))
+    if(TAG(args) == TAG(fun_form)) return CAR(args);
+  return CAR(fun_form);
+}
+/*
+ * @param fun the function `vetr` is called from
+ * @param val_call_raw the `vetr` call, as returned by `sys.call()`
+ * @param fun_frame the frame of `fun`
+ */
 SEXP VALC_validate_args(
-  SEXP fun, SEXP fun_call, SEXP val_call, SEXP fun_frame, SEXP settings
+  SEXP fun, SEXP val_call_raw, SEXP fun_frame, SEXP settings
 ) {
   // For now just use default settings
 
   struct VALC_settings set = VALC_settings_vet(settings, fun_frame);
   set.env = fun_frame;
 
-  // For the elements with validation call setup, check for errors;  Note that
-  // we need to skip the first element of the calls since we only care about the
-  // args.
+  // The plan tells us which formals have vetting expressions, see
+  // `VALC_plan_get`.  The matched validation call has its arguments in the
+  // same order as the formals, so we can walk both of them in lockstep.  Note
+  // that we need to skip the first element of the call since we only care
+  // about the args.
+
+  SEXP plan = PROTECT(VALC_plan_get(fun, val_call_raw, fun_frame));
+  SEXP val_call = VECTOR_ELT(plan, 4);
+  int * val_idx = INTEGER(VECTOR_ELT(plan, 3));
+  int form_i;
 
-  SEXP val_call_cpy, fun_call_cpy, fun_form_cpy;
+  SEXP val_call_cpy = CDR(val_call);
   // note `fun` will always be a closure
-  SEXP fun_form = FORMALS(fun);
-  // `fun_form` is only the formals so we don't need to skip the first value
-  fun_form_cpy = fun_form;
+  SEXP fun_form_cpy = FORMALS(fun);
+
   for(
-    val_call_cpy = CDR(val_call),
-    fun_call_cpy = CDR(fun_call);
-    fun_form_cpy != R_NilValue;
-    fun_form_cpy = CDR(fun_form_cpy),
-    val_call_cpy = CDR(val_call_cpy),
-    fun_call_cpy = CDR(fun_call_cpy)
+    form_i = 0; fun_form_cpy != R_NilValue;
+    fun_form_cpy = CDR(fun_form_cpy), ++form_i
   ) {
-    SEXP arg_tag, val_tag, frm_tag;
-
-    // It is possible for the function call to have more arguments than the
-    // validation call, but for both the arguments should be in the same order
-
-    val_tag = TAG(val_call_cpy);
-    while(fun_form_cpy != R_NilValue) {
-      frm_tag = TAG(fun_form_cpy);
-      arg_tag = TAG(fun_call_cpy);
-      if(val_tag != frm_tag) {
-        fun_form_cpy = CDR(fun_form_cpy);
-        if(frm_tag == arg_tag) fun_call_cpy = CDR(fun_call_cpy);
-      } else {
-        break;
-      }
-    }
-    arg_tag = TAG(fun_call_cpy);
-    frm_tag = TAG(fun_form_cpy);
+    if(val_idx[form_i] < 0) continue;
+
+    SEXP arg_tag = TAG(fun_form_cpy), val_tok = CAR(val_call_cpy);
+    val_call_cpy = CDR(val_call_cpy);
 
-    if(val_tag != frm_tag) {
-      // nocov start
-      error(
-        "%s%s", "Internal Error: validation token does not match formals; ",
-        "contact maintainer."
-      );
-      // nocov end
-    }
-    // Either our function is improperly missing an argument, or we have
-    // validation for a default argument.  Note that since default arguments can
-    // reference other arguments, we can't just assume that the default value is
-    // completely reasonable, although.
-
-    SEXP val_tok, fun_tok = R_MissingArg;
-    if(arg_tag != frm_tag) {
-      if(CAR(fun_form_cpy) != R_MissingArg) {
-        arg_tag = frm_tag;
-        fun_tok = CAR(fun_form_cpy);
-      } else {
-        VALC_arg_error(
-          frm_tag, fun_call, "argument `%s` is missing, with no default"
-        );
-      }
-    } else {
-      fun_tok = CAR(fun_call_cpy);
-    }
-    val_tok = CAR(val_call_cpy);
     if(val_tok == R_MissingArg) {
       // nocov start
       error(
@@ -320,16 +322,18 @@ SEXP VALC_validate_args(
       );
       // nocov end
     }
-
-    if(fun_tok == R_MissingArg) {
-      // this shouldn't really happen now that we're using match.call instead of
-      // match_call
-      // nocov start
-      error(
-        "Internal Error: unexpected missing arg; contact maintainer."
+    // Arguments without defaults that were not specified are bound to the
+    // missing arg.  Arguments with defaults that were not specified are bound
+    // to a promise to evaluate the default, which we vet like any other.
+    // Note that since default arguments can reference other arguments, we
+    // can't just assume that the default value is completely reasonable.
+
+    SEXP fun_bind = findVarInFrame(fun_frame, arg_tag);
+    if(fun_bind == R_MissingArg || fun_bind == R_UnboundValue) {
+      VALC_arg_error(
+        arg_tag, VALC_fun_call(fun_frame),
+        "argument `%s` is missing, with no default"
       );
-      VALC_arg_error(TAG(fun_call_cpy), fun_call, "Argument `%s` is missing");
-      // nocov end
     }
     // Need to evaluate the argument
 
@@ -342,25 +346,47 @@ SEXP VALC_validate_args(
     SEXP fun_val = R_tryEval(arg_tag, fun_frame, err_point);
     if(* err_point) {
       VALC_arg_error(
-        arg_tag, fun_call,
+        arg_tag, VALC_fun_call(fun_frame),
         "Argument `%s` produced error during evaluation; see previous error."
     );}
-    // Evaluate the validation expression
-
-    SEXP val_res = PROTECT(
-      VALC_evaluate(val_tok, fun_tok, arg_tag, fun_val, val_call, set)
-    );
-    if(!IS_TRUE(val_res)) {
-      // fail, produce error message: NOTE - might change if we try to use full
-      // expression instead of just arg name
-      VALC_process_error(val_res, arg_tag, fun_call, 1, 1, set);
-      // nocov start
-      error("Internal Error: should never get here 2487; contact maintainer");
-      // nocov end
+    PROTECT(fun_val);
+
+    // Evaluate the validation expression; the expression the argument was
+    // specified with is only used for error messages, so we only look it up
+    // if the argument fails.  The message pass re-uses the outcomes of the
+    // leaves and the template values from the first pass.  The program could
+    // get dropped from the cache while we run it if a custom expression itself
+    // calls `vet`, so must PROTECT
+
+    SEXP prog = PROTECT(VALC_compile_cached(val_tok, set));
+    struct VALC_leaf_res leaf_res_stack[VALC_LEAF_STACK];
+    struct VALC_leaf_res * leaf_res =
+      VALC_leaf_res_init(prog, leaf_res_stack);
+    SEXP tpl_vals = PROTECT(VALC_leaf_vals(prog));
+
+    if(
+      !VALC_evaluate_lgl(
+        prog, leaf_res, tpl_vals, arg_tag, arg_tag, fun_val, val_call, set
+    ) ) {
+      SEXP fun_call = PROTECT(VALC_fun_call(fun_frame));
+      SEXP fun_tok = VALC_fun_tok(fun_call, fun_form_cpy);
+      SEXP val_res = set.no_msg ? ScalarLogical(0) : VALC_evaluate_msg(
+        prog, leaf_res, tpl_vals, fun_tok, arg_tag, fun_val, val_call, set
+      );
+      PROTECT(val_res);
+      if(!IS_TRUE(val_res)) {
+        VALC_process_error(val_res, arg_tag, fun_call, 1, 1, set);
+        // nocov start
+        error(
+          "Internal Error: should never get here 2487; contact maintainer"
+        );
+        // nocov end
+      }
+      UNPROTECT(2);
     }
-    UNPROTECT(1);
+    UNPROTECT(3);
   }
-  if(val_call_cpy != R_NilValue || fun_call_cpy != R_NilValue) {
+  if(val_call_cpy != R_NilValue) {
     // nocov start
     error(
       "%s%s", "Internal Error: fun and validation matched calls different ",
@@ -368,5 +394,6 @@ SEXP VALC_validate_args(
     );
     // nocov end
   }
+  UNPROTECT(1);
   return VALC_TRUE;
 }
@@ -37,13 +37,72 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
   SEXP VALC_SYM_current;
   SEXP VALC_TRUE;
   SEXP VALC_SYM_errmsg;
+  SEXP VALC_SYM_arg;
+  SEXP VALC_SYM_prog;
+  SEXP VALC_SYM_pure;
+  SEXP VALC_SYM_vetr_set;
+  SEXP VALC_SYM_not;
+  SEXP VALC_SYM_isna;
+  SEXP VALC_SYM_isfinite;
+  SEXP VALC_SYM_gte;
+  SEXP VALC_SYM_lte;
+  SEXP VALC_SYM_gt;
+  SEXP VALC_SYM_lt;
+  SEXP VALC_SYM_minus;
+  SEXP VALC_SYM_elementwise;
+
+  // Compiled vetting programs, see compile.c
+
+  #define VALC_OP_TEMPLATE 1
+  #define VALC_OP_CUSTOM   2
+  #define VALC_OP_AND      3
+  #define VALC_OP_OR_INIT  4
+  #define VALC_OP_OR       5
+  #define VALC_OP_OR_END   6
+
+  // `struct VALC_op.aux` flag for templates that can be evaluated just once;
+  // for custom leaves `aux` instead holds the `SCAN_KERN_*` kernel, if any
+
+  #define VALC_OP_AUX_PURE 1
+
+  // Nesting depth of `||` beyond which we need to allocate memory to run
+
+  #define VALC_OR_DEPTH_STACK 32
+
+  struct VALC_op {
+    int code;
+    int jump;   // op index to jump to for AND / OR
+    int leaf;   // leaf expression index for TEMPLATE / CUSTOM
+    int aux;
+  };
+  // Outcome of leaves, recorded so the diagnostic run does not need to
+  // re-evaluate them, see `VALC_evaluate`
+
+  #define VALC_LEAF_STACK 32
+
+  // Most kernel leaves joined by `&&` that we run in a single pass
+
+  #define VALC_KERN_CHAIN 16
+
+  struct VALC_leaf_res {
+    int done;
+    int code;   // return value of `VALC_all`
+    int type;   // type of the evaluated custom expression
+  };
+  struct VALC_prog {
+    int n_ops;
+    int n_leaves;
+    int or_depth;
+    int flags;
+    struct VALC_op ops[];
+  };
 
   SEXP VALC_validate(
     SEXP target, SEXP current, SEXP cur_sub, SEXP par_call, SEXP rho,
     SEXP ret_mode_sxp, SEXP stop, SEXP settings
   );
   SEXP VALC_validate_args(
-    SEXP fun, SEXP fun_call, SEXP val_call, SEXP fun_frame, SEXP settings
+    SEXP fun, SEXP val_call_raw, SEXP fun_frame, SEXP settings
   );
   SEXP VALC_remove_parens(SEXP lang);
   SEXP VALC_name_sub_ext(SEXP symb, SEXP arg_name);
@@ -54,15 +113,40 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
   int IS_TRUE(SEXP x);
   int IS_LANG(SEXP x);
   SEXP VALC_parse(
-    SEXP lang, SEXP var_name, struct VALC_settings settings
+    SEXP lang, SEXP var_name, struct VALC_settings settings, SEXP deps
+  );
+  SEXP VALC_compile_cached(SEXP lang, struct VALC_settings set);
+  SEXP VALC_compile(SEXP lang, struct VALC_settings set, SEXP deps);
+  SEXP VALC_compile_parsed(
+    SEXP lang, SEXP parsed, struct VALC_settings set, SEXP deps
   );
+  SEXP VALC_compile_ext(SEXP lang, SEXP rho, SEXP settings);
+  int VALC_is_prog(SEXP x);
+  struct VALC_prog * VALC_prog_get(SEXP prog_sxp);
+  SEXP VALC_prog_leaves(SEXP prog_sxp);
+  SEXP VALC_prog_memo(SEXP prog_sxp);
+  SEXP VALC_find_fun(SEXP symb, SEXP rho);
+  SEXP VALC_sub_arg(SEXP lang, SEXP arg_lang);
+  SEXP VALC_run(
+    SEXP prog_sxp, struct VALC_leaf_res * leaf_res, SEXP tpl_vals,
+    SEXP arg_value, SEXP arg_lang, SEXP arg_tag, SEXP lang_full,
+    struct VALC_settings set
+  );
+  void VALC_parse_dep_add(SEXP deps, SEXP symb, SEXP val);
+  void VALC_parse_dep_fun_add(SEXP deps, SEXP symb, SEXP fun);
+  void VALC_not_mutable(SEXP x);
+  SEXP VALC_plan_get(SEXP fun, SEXP val_call_raw, SEXP fun_frame);
+  void VALC_parse_cache_init();
+  SEXP VALC_parse_cache_stats(SEXP reset);
   SEXP VALC_parse_ext(SEXP lang, SEXP var_name, SEXP rho);
   void VALC_parse_recurse(
     SEXP lang, SEXP lang_track, SEXP var_name, int eval_as_is,
-    SEXP first_fun, struct VALC_settings set, struct track_hash * track_hash
+    SEXP first_fun, struct VALC_settings set, struct track_hash * track_hash,
+    SEXP deps
   );
   SEXP VALC_sub_symbol(
-    SEXP lang, struct VALC_settings set, struct track_hash * track_hash
+    SEXP lang, struct VALC_settings set, struct track_hash * track_hash,
+    SEXP deps
   );
   SEXP VALC_sub_symbol_ext(SEXP lang, SEXP rho);
   void VALC_install_objs();
@@ -74,6 +158,20 @@ Go to <https://www.r-project.org/Licenses/GPL-2> for a copy of the license.
     SEXP lang, SEXP arg_lang, SEXP arg_tag, SEXP arg_value, SEXP lang_full,
     SEXP rho
   );
+  struct VALC_leaf_res * VALC_leaf_res_init(
+    SEXP prog, struct VALC_leaf_res * stack
+  );
+  SEXP VALC_leaf_vals(SEXP prog);
+  int VALC_evaluate_lgl(
+    SEXP prog, struct VALC_leaf_res * leaf_res, SEXP tpl_vals,
+    SEXP arg_lang, SEXP arg_tag, SEXP arg_value, SEXP lang_full,
+    struct VALC_settings set
+  );
+  SEXP VALC_evaluate_msg(
+    SEXP prog, struct VALC_leaf_res * leaf_res, SEXP tpl_vals,
+    SEXP arg_lang, SEXP arg_tag, SEXP arg_value, SEXP lang_full,
+    struct VALC_settings set
+  );
   void VALC_arg_error(SEXP tag, SEXP fun_call, const char * err_base);
   void psh(const char * lab);
 